@@ -0,0 +1,319 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "AsyncWriter.h"
+
+//! The alignment of all buffers and direct writes
+static const size_t gPageSize = 4096;
+
+//! Return the current time in seconds
+static double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AsyncWriter::AsyncWriter(size_t buffer_size, uint32_t buffer_count) : mFile(-1), mOwnFile(false),
+    mDirect(false), mCurrent(NULL), mFill(0), mPosition(0), mDone(false), mFailed(false),
+    mWriteTime(0), mWaitTime(0), mStartTime(0)
+{
+  void* buffer;
+
+  mBufferSize = ((buffer_size + gPageSize - 1) / gPageSize) * gPageSize;
+
+  if (buffer_count < 2)
+    buffer_count = 2;
+
+  for (uint32_t i=0;i<buffer_count;i++) {
+    if (posix_memalign(&buffer,gPageSize,mBufferSize) != 0)
+      break;
+
+    mBuffers.push_back((char*)buffer);
+  }
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  if (mFile >= 0)
+    close();
+
+  for (size_t i=0;i<mBuffers.size();i++)
+    free(mBuffers[i]);
+}
+
+int AsyncWriter::open(const char* filename, bool direct)
+{
+  if (mBuffers.size() < 2) {
+    fprintf(stderr,"Error, could not allocate the output buffers\n");
+    return 0;
+  }
+
+  if (filename == NULL) {
+    mFile = STDOUT_FILENO;
+    mOwnFile = false;
+    mDirect = false;
+  }
+  else {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    mFile = -1;
+    mDirect = false;
+
+#ifdef O_DIRECT
+    // Not all file systems support direct I/O so we silently fall back
+    // to buffered writes
+    if (direct) {
+      mFile = ::open(filename,flags | O_DIRECT,0644);
+      mDirect = (mFile >= 0);
+    }
+#endif
+
+    if (mFile < 0)
+      mFile = ::open(filename,flags,0644);
+
+    if (mFile < 0) {
+      fprintf(stderr,"Error, could not open output file \"%s\": %s\n",filename,strerror(errno));
+      return 0;
+    }
+    mOwnFile = true;
+  }
+
+  mFree.assign(mBuffers.begin()+1,mBuffers.end());
+  mFull.clear();
+  mCurrent = mBuffers[0];
+  mFill = 0;
+  mPosition = 0;
+  mDone = false;
+  mFailed = false;
+  mWriteTime = 0;
+  mWaitTime = 0;
+  mStartTime = now();
+
+  mThread = std::thread(&AsyncWriter::run,this);
+
+  return 1;
+}
+
+int AsyncWriter::write(const void* data, size_t bytes)
+{
+  const char* src = (const char*)data;
+  size_t count;
+
+  while (bytes > 0) {
+    count = std::min(bytes,mBufferSize - mFill);
+
+    memcpy(mCurrent + mFill,src,count);
+    mFill += count;
+    mPosition += count;
+    src += count;
+    bytes -= count;
+
+    if ((mFill == mBufferSize) && (flush() == 0))
+      return 0;
+  }
+
+  return 1;
+}
+
+int AsyncWriter::flush()
+{
+  Block block;
+  double start = now();
+
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  if (mFailed)
+    return 0;
+
+  block.data = mCurrent;
+  block.size = mFill;
+  mFull.push_back(block);
+  mQueued.notify_one();
+
+  // Wait for the writer to return a buffer
+  while (mFree.empty() && !mFailed)
+    mReleased.wait(lock);
+
+  if (mFailed)
+    return 0;
+
+  mCurrent = mFree.back();
+  mFree.pop_back();
+  mFill = 0;
+
+  mWaitTime += now() - start;
+
+  return 1;
+}
+
+int AsyncWriter::close()
+{
+  if (mFile < 0)
+    return 0;
+
+  // Queue the partially filled buffer and let the writer drain the queue
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (mFill > 0) {
+      Block block;
+      block.data = mCurrent;
+      block.size = mFill;
+      mFull.push_back(block);
+    }
+    mCurrent = NULL;
+    mDone = true;
+    mQueued.notify_one();
+  }
+
+  mThread.join();
+
+  if (mOwnFile)
+    ::close(mFile);
+  mFile = -1;
+
+  double elapsed = now() - mStartTime;
+  double mb = mPosition / (1024.0*1024.0);
+
+  fprintf(stderr,"Wrote %.1f MB in %.3f s: %.1f MB/s while writing, %.1f MB/s overall, %.3f s waiting for buffers\n",
+          mb,mWriteTime,(mWriteTime > 0) ? mb / mWriteTime : 0,(elapsed > 0) ? mb / elapsed : 0,mWaitTime);
+
+  if (mFailed)
+    return 0;
+
+  return 1;
+}
+
+void AsyncWriter::run()
+{
+  Block block;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      while (mFull.empty() && !mDone)
+        mQueued.wait(lock);
+
+      if (mFull.empty())
+        return;
+
+      block = mFull.front();
+      mFull.pop_front();
+    }
+
+    bool success = writeBlock(block);
+
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      if (!success)
+        mFailed = true;
+
+      mFree.push_back(block.data);
+      mReleased.notify_one();
+    }
+  }
+}
+
+bool AsyncWriter::writeBlock(const Block& block)
+{
+  size_t offset = 0;
+  ssize_t count;
+  double start = now();
+
+#ifdef O_DIRECT
+  // Direct I/O requires sizes that are multiples of the block size. Only
+  // the final buffer can violate this, so for the remainder of the file
+  // we switch back to buffered writes
+  if (mDirect && ((block.size % gPageSize) != 0)) {
+    fcntl(mFile,F_SETFL,fcntl(mFile,F_GETFL) & ~O_DIRECT);
+    mDirect = false;
+  }
+#endif
+
+  while (offset < block.size) {
+    count = ::write(mFile,block.data + offset,block.size - offset);
+
+    if ((count < 0) && (errno == EINTR))
+      continue;
+
+    if (count <= 0) {
+      fprintf(stderr,"Error, could not write the output: %s\n",strerror(errno));
+      return false;
+    }
+    offset += count;
+  }
+
+  mWriteTime += now() - start;
+
+  return true;
+}
@@ -0,0 +1,191 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//! Double-buffered output stream with a dedicated writer thread
+/*! Data passed to write() is copied into one of a small pool of large,
+ *  page aligned buffers. Full buffers are handed to a writer thread so
+ *  the caller can continue computing the next part of the output while
+ *  the previous one is written. Optionally, the file is opened with
+ *  O_DIRECT in which case all but the last buffer are written as large
+ *  aligned blocks bypassing the page cache.
+ */
+class AsyncWriter
+{
+public:
+
+  //! Constructor
+  /*!
+   * @param buffer_size The size of each buffer in bytes (rounded up to
+   *        a multiple of the page size)
+   * @param buffer_count The number of buffers in the pool (at least 2)
+   */
+  AsyncWriter(size_t buffer_size=16 << 20, uint32_t buffer_count=3);
+
+  //! Destructor which closes the file if necessary
+  ~AsyncWriter();
+
+  //! Open the given file or stdout if filename is NULL
+  /*!
+   * @param filename The name of the output file or NULL for stdout
+   * @param direct Whether to try to bypass the page cache
+   * @return 1 if successful 0 otherwise
+   */
+  int open(const char* filename, bool direct=false);
+
+  //! Append the given data to the output
+  int write(const void* data, size_t bytes);
+
+  //! Return the number of bytes passed to write() so far
+  uint64_t position() const {return mPosition;}
+
+  //! Write all pending data, close the file and report the throughput
+  int close();
+
+private:
+
+  //! A filled buffer waiting to be written
+  struct Block {
+    char* data;
+    size_t size;
+  };
+
+  //! The file descriptor
+  int mFile;
+
+  //! Whether the file descriptor is owned by the writer
+  bool mOwnFile;
+
+  //! Whether the file is currently opened with O_DIRECT
+  bool mDirect;
+
+  //! The size of each buffer
+  size_t mBufferSize;
+
+  //! All buffers of the pool
+  std::vector<char*> mBuffers;
+
+  //! The buffers available to the caller
+  std::vector<char*> mFree;
+
+  //! The buffers waiting to be written in order
+  std::deque<Block> mFull;
+
+  //! The buffer currently being filled
+  char* mCurrent;
+
+  //! The number of bytes in the current buffer
+  size_t mFill;
+
+  //! The number of bytes passed to write()
+  uint64_t mPosition;
+
+  //! Flag indicating that no more buffers will be queued
+  bool mDone;
+
+  //! Flag indicating that a write has failed
+  bool mFailed;
+
+  //! Time the writer thread spent in write calls
+  double mWriteTime;
+
+  //! Time the caller spent waiting for a free buffer
+  double mWaitTime;
+
+  //! The time the file was opened
+  double mStartTime;
+
+  //! Lock protecting the queues and flags
+  std::mutex mMutex;
+
+  //! Signal that a buffer has been queued or the stream has finished
+  std::condition_variable mQueued;
+
+  //! Signal that a buffer has been returned to the pool
+  std::condition_variable mReleased;
+
+  //! The writer thread
+  std::thread mThread;
+
+  //! Queue the current buffer and acquire a free one
+  int flush();
+
+  //! The main loop of the writer thread
+  void run();
+
+  //! Write one block to the file
+  bool writeBlock(const Block& block);
+};
+
+
+#endif /* ASYNCWRITER_H_ */
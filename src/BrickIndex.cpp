@@ -0,0 +1,220 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+
+#include "BrickIndex.h"
+
+void brick_counts(const uint32_t dim[3], uint32_t brick_size, uint32_t counts[3])
+{
+  for (int i=0;i<3;i++)
+    counts[i] = (dim[i] + brick_size - 1) / brick_size;
+}
+
+void brick_box(const uint32_t dim[3], uint32_t brick_size, uint32_t brick,
+               uint32_t low[3], uint32_t high[3])
+{
+  uint32_t counts[3];
+
+  brick_counts(dim,brick_size,counts);
+
+  low[0] = (brick % counts[0])*brick_size;
+  low[1] = ((brick / counts[0]) % counts[1])*brick_size;
+  low[2] = (brick / (counts[0]*counts[1]))*brick_size;
+
+  for (int i=0;i<3;i++)
+    high[i] = std::min(low[i] + brick_size,dim[i]);
+}
+
+void BrickIndex::initialize(const GlobalIndexType dim[3], uint32_t brick_size)
+{
+  for (int i=0;i<3;i++)
+    mDim[i] = (uint32_t)dim[i];
+
+  mBrickSize = brick_size;
+
+  mLevels.resize(1);
+  brick_counts(mDim,mBrickSize,mLevels[0].counts);
+
+  uint32_t count = mLevels[0].counts[0]*mLevels[0].counts[1]*mLevels[0].counts[2];
+  mLevels[0].min.assign(count,0);
+  mLevels[0].max.assign(count,0);
+}
+
+void BrickIndex::build(const FunctionType* data, const GlobalIndexType dim[3], uint32_t brick_size)
+{
+  initialize(dim,brick_size);
+
+  Level& finest = mLevels[0];
+
+#pragma omp parallel for schedule(dynamic,16)
+  for (int64_t b=0;b<(int64_t)finest.min.size();b++) {
+    uint32_t low[3],high[3];
+
+    box(b,low,high);
+
+    FunctionType lo = data[(low[2]*dim[1] + low[1])*dim[0] + low[0]];
+    FunctionType hi = lo;
+
+    for (uint32_t z=low[2];z<high[2];z++) {
+      for (uint32_t y=low[1];y<high[1];y++) {
+        const FunctionType* row = data + (z*dim[1] + y)*dim[0];
+
+        for (uint32_t x=low[0];x<high[0];x++) {
+          lo = std::min(lo,row[x]);
+          hi = std::max(hi,row[x]);
+        }
+      }
+    }
+
+    finest.min[b] = lo;
+    finest.max[b] = hi;
+  }
+
+  buildHierarchy();
+}
+
+void BrickIndex::buildHierarchy()
+{
+  mLevels.resize(1);
+
+  while (mLevels.back().min.size() > 1) {
+    Level coarse;
+    const Level& fine = mLevels.back();
+
+    for (int i=0;i<3;i++)
+      coarse.counts[i] = (fine.counts[i] + 1) / 2;
+
+    coarse.min.resize(coarse.counts[0]*coarse.counts[1]*coarse.counts[2]);
+    coarse.max.resize(coarse.min.size());
+
+    for (uint32_t z=0;z<coarse.counts[2];z++) {
+      for (uint32_t y=0;y<coarse.counts[1];y++) {
+        for (uint32_t x=0;x<coarse.counts[0];x++) {
+          uint32_t c = (z*coarse.counts[1] + y)*coarse.counts[0] + x;
+          bool first = true;
+
+          // Combine the (up to) eight children
+          for (uint32_t fz=2*z;fz<std::min(2*z+2,fine.counts[2]);fz++) {
+            for (uint32_t fy=2*y;fy<std::min(2*y+2,fine.counts[1]);fy++) {
+              for (uint32_t fx=2*x;fx<std::min(2*x+2,fine.counts[0]);fx++) {
+                uint32_t f = (fz*fine.counts[1] + fy)*fine.counts[0] + fx;
+
+                coarse.min[c] = first ? fine.min[f] : std::min(coarse.min[c],fine.min[f]);
+                coarse.max[c] = first ? fine.max[f] : std::max(coarse.max[c],fine.max[f]);
+                first = false;
+              }
+            }
+          }
+        }
+      }
+    }
+
+    mLevels.push_back(coarse);
+  }
+}
+
+FunctionType BrickIndex::lowest(const Comparison& greater) const
+{
+  const Level& top = mLevels.back();
+
+  return greater(top.max[0],top.min[0]) ? top.min[0] : top.max[0];
+}
+
+uint32_t BrickIndex::activeBricks(const Comparison& greater, FunctionType threshold,
+                                  std::vector<char>& mask) const
+{
+  std::vector<char> parent(1,1);
+
+  for (int l=(int)mLevels.size()-1;l>=0;l--) {
+    const Level& level = mLevels[l];
+    const Level* coarse = (l + 1 < (int)mLevels.size()) ? &mLevels[l+1] : NULL;
+
+    mask.assign(level.min.size(),0);
+
+    for (uint32_t z=0;z<level.counts[2];z++) {
+      for (uint32_t y=0;y<level.counts[1];y++) {
+        for (uint32_t x=0;x<level.counts[0];x++) {
+          uint32_t b = (z*level.counts[1] + y)*level.counts[0] + x;
+
+          // Children of rejected bricks are rejected without looking at them
+          if ((coarse != NULL)
+              && !parent[((z/2)*coarse->counts[1] + y/2)*coarse->counts[0] + x/2])
+            continue;
+
+          mask[b] = greater(level.max[b],threshold) || greater(level.min[b],threshold);
+        }
+      }
+    }
+
+    parent.swap(mask);
+  }
+
+  mask.swap(parent);
+
+  uint32_t count = 0;
+  for (uint32_t b=0;b<mask.size();b++)
+    count += mask[b];
+
+  return count;
+}
@@ -0,0 +1,195 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef BRICKINDEX_H
+#define BRICKINDEX_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+
+//! Return the number of bricks in each dimension
+void brick_counts(const uint32_t dim[3], uint32_t brick_size, uint32_t counts[3]);
+
+//! Compute the extent [low,high) of the given brick
+void brick_box(const uint32_t dim[3], uint32_t brick_size, uint32_t brick,
+               uint32_t low[3], uint32_t high[3]);
+
+//! A hierarchy of the minimum and maximum function values of the bricks of a volume
+/*! Bricks are cubes of brickSize()^3 vertices (clipped at the boundary)
+ *  numbered in x-fastest order. Above these finest bricks each level
+ *  combines 2x2x2 bricks of the level below until a single brick covers
+ *  the volume. The index does not depend on the threshold and thus can
+ *  be reused for any number of thresholds. Given a threshold it
+ *  determines the bricks that may contain a vertex above it, allowing
+ *  the screening and the output to skip all others in bulk.
+ */
+class BrickIndex
+{
+public:
+
+  //! Default constructor
+  BrickIndex() : mBrickSize(0) {}
+
+  //! Destructor
+  ~BrickIndex() {}
+
+  //! Set the dimensions and allocate the summary of the finest bricks
+  void initialize(const GlobalIndexType dim[3], uint32_t brick_size);
+
+  //! Summarize the given volume in parallel and build the hierarchy
+  void build(const FunctionType* data, const GlobalIndexType dim[3], uint32_t brick_size);
+
+  //! Build the coarser levels once all finest bricks have their range set
+  void buildHierarchy();
+
+  //! Return whether the index has been initialized
+  bool empty() const {return mLevels.empty();}
+
+  //! Return the edge length of a brick
+  uint32_t brickSize() const {return mBrickSize;}
+
+  //! Return the number of bricks in each dimension
+  const uint32_t* counts() const {return mLevels[0].counts;}
+
+  //! Return the total number of bricks
+  uint32_t brickCount() const {return (uint32_t)mLevels[0].min.size();}
+
+  //! Return the number of levels including the finest one
+  uint32_t levelCount() const {return (uint32_t)mLevels.size();}
+
+  //! Return the brick with the given brick coordinates
+  uint32_t brick(uint32_t bx, uint32_t by, uint32_t bz) const {
+    return (bz*mLevels[0].counts[1] + by)*mLevels[0].counts[0] + bx;
+  }
+
+  //! Compute the extent [low,high) of the given brick
+  void box(uint32_t brick, uint32_t low[3], uint32_t high[3]) const {
+    brick_box(mDim,mBrickSize,brick,low,high);
+  }
+
+  //! Set the range of the given brick
+  void range(uint32_t brick, FunctionType low, FunctionType high) {
+    mLevels[0].min[brick] = low;
+    mLevels[0].max[brick] = high;
+  }
+
+  //! Return the smallest value of the given brick
+  FunctionType minimum(uint32_t brick) const {return mLevels[0].min[brick];}
+
+  //! Return the largest value of the given brick
+  FunctionType maximum(uint32_t brick) const {return mLevels[0].max[brick];}
+
+  //! Return whether the brick may contain a vertex above the threshold
+  bool active(uint32_t brick, const Comparison& greater, FunctionType threshold) const {
+    return greater(mLevels[0].max[brick],threshold) || greater(mLevels[0].min[brick],threshold);
+  }
+
+  //! Return the lowest value of the brick with respect to the given comparison
+  FunctionType lowest(uint32_t brick, const Comparison& greater) const {
+    return greater(mLevels[0].max[brick],mLevels[0].min[brick]) ? mLevels[0].min[brick] : mLevels[0].max[brick];
+  }
+
+  //! Return the lowest value of the volume with respect to the given comparison
+  FunctionType lowest(const Comparison& greater) const;
+
+  //! Determine which bricks may contain a vertex above the threshold
+  /*! The hierarchy is traversed top-down so whole regions below the
+   *  threshold are rejected at the coarsest possible level.
+   * @param greater The comparison defining the tree type
+   * @param threshold The threshold
+   * @param mask One entry per brick set to 1 for active bricks
+   * @return The number of active bricks
+   */
+  uint32_t activeBricks(const Comparison& greater, FunctionType threshold,
+                        std::vector<char>& mask) const;
+
+private:
+
+  //! The summary of one level of the hierarchy
+  struct Level {
+
+    //! The number of bricks in each dimension
+    uint32_t counts[3];
+
+    //! The smallest value of each brick
+    std::vector<FunctionType> min;
+
+    //! The largest value of each brick
+    std::vector<FunctionType> max;
+  };
+
+  //! The dimensions of the volume
+  uint32_t mDim[3];
+
+  //! The edge length of a brick
+  uint32_t mBrickSize;
+
+  //! The levels from finest to coarsest
+  std::vector<Level> mLevels;
+};
+
+
+#endif /* BRICKINDEX_H_ */
@@ -0,0 +1,352 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "BrickedVolume.h"
+
+//! The identifier at the beginning of a bricked volume
+static const char gBrickedMagic[4] = {'A','D','B','V'};
+
+//! The identifier at the end of a bricked volume
+static const char gIndexMagic[4] = {'A','D','B','I'};
+
+//! The size of the trailer
+static const size_t gTrailerSize = sizeof(uint64_t) + 4;
+
+bool is_bricked_volume(const char* filename)
+{
+  struct stat info;
+  char magic[4];
+
+  // Never consume the beginning of a pipe
+  if ((stat(filename,&info) != 0) || !S_ISREG(info.st_mode))
+    return false;
+
+  FILE* input = fopen(filename,"rb");
+  if (input == NULL)
+    return false;
+
+  bool bricked = (fread(magic,1,4,input) == 4) && (memcmp(magic,gBrickedMagic,4) == 0);
+  fclose(input);
+
+  return bricked;
+}
+
+BrickedWriter::BrickedWriter(const GlobalIndexType dim[3], uint32_t brick_size, const Quantizer* quantizer,
+                             const char* metric, int tree_type, FunctionType threshold, FunctionType fill)
+{
+  memset(&mHeader,0,sizeof(BrickedHeader));
+
+  memcpy(mHeader.magic,gBrickedMagic,4);
+  mHeader.version = 1;
+  mHeader.dim[0] = (uint32_t)dim[0];
+  mHeader.dim[1] = (uint32_t)dim[1];
+  mHeader.dim[2] = (uint32_t)dim[2];
+  mHeader.brickSize = brick_size;
+  mHeader.treeType = tree_type;
+  mHeader.threshold = threshold;
+  mHeader.fillValue = fill;
+  strncpy(mHeader.metric,metric,sizeof(mHeader.metric)-1);
+
+  if ((quantizer != NULL) && (quantizer->bits() > 0)) {
+    mQuantizer = *quantizer;
+    mHeader.dataType = (quantizer->bits() == 8) ? DATA_UINT8 : DATA_UINT16;
+    mHeader.offset = quantizer->offset();
+    mHeader.scale = quantizer->scale();
+  }
+  else {
+    mHeader.dataType = DATA_FLOAT32;
+    mHeader.offset = 0;
+    mHeader.scale = 1;
+  }
+
+  mSlab.resize(dim[0]*dim[1]*brick_size);
+  mPlanes = 0;
+}
+
+int BrickedWriter::open(const char* filename, bool direct)
+{
+  if (VolumeOutput::open(filename,direct) == 0)
+    return 0;
+
+  mPlanes = 0;
+  mIndex.clear();
+
+  return mOutput.write(&mHeader,sizeof(BrickedHeader));
+}
+
+int BrickedWriter::writePlane(const FunctionType* plane, const LocalIndexType* /*labels*/)
+{
+  GlobalIndexType plane_size = mHeader.dim[0]*mHeader.dim[1];
+
+  memcpy(&mSlab[(mPlanes % mHeader.brickSize)*plane_size],plane,plane_size*sizeof(FunctionType));
+  mPlanes++;
+
+  if (((mPlanes % mHeader.brickSize) == 0) || (mPlanes == mHeader.dim[2]))
+    return flushSlab();
+
+  return 1;
+}
+
+int BrickedWriter::flushSlab()
+{
+  uint32_t counts[3];
+  brick_counts(mHeader.dim,mHeader.brickSize,counts);
+
+  uint32_t slab = (mPlanes - 1) / mHeader.brickSize;
+  uint32_t first = slab*counts[0]*counts[1];
+  uint32_t count = counts[0]*counts[1];
+  size_t element = data_type_size((DataType)mHeader.dataType);
+
+  std::vector<std::vector<char> > encoded(count);
+  std::vector<BrickEntry> entries(count);
+
+  // Gather, summarize and encode all bricks of the slab independently
+#pragma omp parallel for schedule(dynamic,1)
+  for (int64_t b=0;b<(int64_t)count;b++) {
+    uint32_t low[3],high[3];
+    std::vector<FunctionType> values;
+    FunctionType lo = std::numeric_limits<FunctionType>::max();
+    FunctionType hi = std::numeric_limits<FunctionType>::lowest();
+
+    brick_box(mHeader.dim,mHeader.brickSize,first + b,low,high);
+    values.reserve((high[0]-low[0])*(high[1]-low[1])*(high[2]-low[2]));
+
+    for (uint32_t z=low[2];z<high[2];z++) {
+      for (uint32_t y=low[1];y<high[1];y++) {
+        const FunctionType* row = &mSlab[((z - low[2])*mHeader.dim[1] + y)*mHeader.dim[0]];
+
+        for (uint32_t x=low[0];x<high[0];x++) {
+          values.push_back(row[x]);
+          lo = std::min(lo,row[x]);
+          hi = std::max(hi,row[x]);
+        }
+      }
+    }
+
+    entries[b].min = lo;
+    entries[b].max = hi;
+
+    encoded[b].resize(values.size()*element);
+    if (mHeader.dataType == DATA_FLOAT32)
+      memcpy(&encoded[b][0],&values[0],encoded[b].size());
+    else
+      mQuantizer.encode(&values[0],&encoded[b][0],values.size());
+  }
+
+  // Append the bricks in order
+  for (uint32_t b=0;b<count;b++) {
+    entries[b].offset = mOutput.position();
+    if (mOutput.write(&encoded[b][0],encoded[b].size()) == 0)
+      return 0;
+    mIndex.push_back(entries[b]);
+  }
+
+  return 1;
+}
+
+int BrickedWriter::close()
+{
+  uint64_t index_offset = mOutput.position();
+
+  if ((mOutput.write(&mIndex[0],mIndex.size()*sizeof(BrickEntry)) == 0)
+      || (mOutput.write(&index_offset,sizeof(uint64_t)) == 0)
+      || (mOutput.write(gIndexMagic,4) == 0)) {
+    mOutput.close();
+    return 0;
+  }
+
+  return mOutput.close();
+}
+
+BrickedReader::~BrickedReader()
+{
+  if (mFile >= 0)
+    close(mFile);
+}
+
+//! Read exactly the given number of bytes at the given offset
+static int read_at(int fd, void* buffer, size_t bytes, uint64_t offset)
+{
+  size_t done = 0;
+  ssize_t count;
+
+  while (done < bytes) {
+    count = pread(fd,(char*)buffer + done,bytes - done,offset + done);
+
+    if ((count < 0) && (errno == EINTR))
+      continue;
+
+    if (count <= 0)
+      return 0;
+
+    done += count;
+  }
+
+  return 1;
+}
+
+int BrickedReader::open(const char* filename)
+{
+  struct stat info;
+  uint64_t index_offset;
+  char magic[4];
+  uint32_t counts[3];
+
+  mFile = ::open(filename,O_RDONLY);
+  if ((mFile < 0) || (fstat(mFile,&info) != 0)) {
+    fprintf(stderr,"Error, could not open bricked volume \"%s\"\n",filename);
+    return 0;
+  }
+
+  if (((size_t)info.st_size < sizeof(BrickedHeader) + gTrailerSize)
+      || (read_at(mFile,&mHeader,sizeof(BrickedHeader),0) == 0)
+      || (memcmp(mHeader.magic,gBrickedMagic,4) != 0)
+      || (read_at(mFile,&index_offset,sizeof(uint64_t),info.st_size - gTrailerSize) == 0)
+      || (read_at(mFile,magic,4,info.st_size - 4) == 0)
+      || (memcmp(magic,gIndexMagic,4) != 0)) {
+    fprintf(stderr,"Error, \"%s\" is not a bricked volume\n",filename);
+    return 0;
+  }
+
+  // A corrupt header would otherwise divide by zero or index past the file
+  if ((mHeader.brickSize == 0) || (mHeader.dim[0] == 0) || (mHeader.dim[1] == 0)
+      || (mHeader.dim[2] == 0) || ((mHeader.dataType != DATA_FLOAT32)
+                                   && (mHeader.dataType != DATA_UINT8)
+                                   && (mHeader.dataType != DATA_UINT16))) {
+    fprintf(stderr,"Error, invalid header in bricked volume \"%s\"\n",filename);
+    return 0;
+  }
+
+  brick_counts(mHeader.dim,mHeader.brickSize,counts);
+  uint64_t bricks = (uint64_t)counts[0]*counts[1]*counts[2];
+
+  if ((index_offset < sizeof(BrickedHeader))
+      || (index_offset + bricks*sizeof(BrickEntry) + gTrailerSize != (uint64_t)info.st_size)) {
+    fprintf(stderr,"Error, the brick index of \"%s\" does not match its header\n",filename);
+    return 0;
+  }
+
+  mIndex.resize(bricks);
+
+  if (read_at(mFile,&mIndex[0],mIndex.size()*sizeof(BrickEntry),index_offset) == 0) {
+    fprintf(stderr,"Error, could not read the brick index of \"%s\"\n",filename);
+    return 0;
+  }
+
+  // Every brick must lie between the header and the index
+  size_t element = data_type_size((DataType)mHeader.dataType);
+  for (uint32_t b=0;b<mIndex.size();b++) {
+    uint32_t low[3],high[3];
+
+    brick_box(mHeader.dim,mHeader.brickSize,b,low,high);
+    uint64_t bytes = (uint64_t)(high[0]-low[0])*(high[1]-low[1])*(high[2]-low[2])*element;
+
+    if ((mIndex[b].offset < sizeof(BrickedHeader)) || (mIndex[b].offset + bytes > index_offset)) {
+      fprintf(stderr,"Error, brick %u of \"%s\" lies outside the data\n",b,filename);
+      return 0;
+    }
+  }
+
+  if (mHeader.dataType != DATA_FLOAT32)
+    mQuantizer.mapping((mHeader.dataType == DATA_UINT8) ? 8 : 16,mHeader.offset,mHeader.scale);
+
+  return 1;
+}
+
+void BrickedReader::query(FunctionType cutoff, std::vector<uint32_t>& bricks) const
+{
+  bricks.clear();
+  for (uint32_t i=0;i<mIndex.size();i++) {
+    if (mIndex[i].max >= cutoff)
+      bricks.push_back(i);
+  }
+}
+
+int BrickedReader::readBrick(uint32_t brick, std::vector<FunctionType>& values) const
+{
+  uint32_t low[3],high[3];
+  size_t element = data_type_size((DataType)mHeader.dataType);
+
+  brick_box(mHeader.dim,mHeader.brickSize,brick,low,high);
+  values.resize((high[0]-low[0])*(high[1]-low[1])*(high[2]-low[2]));
+
+  if (mHeader.dataType == DATA_FLOAT32)
+    return read_at(mFile,&values[0],values.size()*element,mIndex[brick].offset);
+
+  std::vector<char> encoded(values.size()*element);
+  if (read_at(mFile,&encoded[0],encoded.size(),mIndex[brick].offset) == 0)
+    return 0;
+
+  mQuantizer.decode(&encoded[0],&values[0],values.size());
+
+  return 1;
+}
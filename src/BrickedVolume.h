@@ -0,0 +1,240 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef BRICKEDVOLUME_H
+#define BRICKEDVOLUME_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "Definitions.h"
+#include "DataType.h"
+#include "Quantizer.h"
+#include "VolumeOutput.h"
+#include "BrickIndex.h"
+
+/*! A bricked volume file consists of a BrickedHeader, the encoded bricks,
+ *  the brick index (one BrickEntry per brick) and a trailer containing
+ *  the uint64 file offset of the index followed by the characters "ADBI".
+ *  Bricks are cubes of brickSize^3 values (clipped at the boundary) and
+ *  are stored in x-fastest order, both within a brick and among bricks.
+ *  Since the index follows the data the file can be written as a stream.
+ */
+
+//! The fixed size header of a bricked volume
+struct BrickedHeader
+{
+  //! The characters "ADBV"
+  char magic[4];
+
+  //! The version of the format
+  uint32_t version;
+
+  //! The dimensions of the volume
+  uint32_t dim[3];
+
+  //! The edge length of a brick
+  uint32_t brickSize;
+
+  //! The DataType of the stored values (float32, uint8 or uint16)
+  uint32_t dataType;
+
+  //! The tree type used to compute the values (0 merge, 1 split, -1 for unprocessed data)
+  int32_t treeType;
+
+  //! The offset of quantized values
+  float offset;
+
+  //! The scale of quantized values
+  float scale;
+
+  //! The value of unlabeled vertices
+  float fillValue;
+
+  //! The threshold used to compute the tree
+  float threshold;
+
+  //! The name of the metric stored
+  char metric[16];
+};
+
+//! The index entry of a single brick
+struct BrickEntry
+{
+  //! The file offset of the first value of the brick
+  uint64_t offset;
+
+  //! The smallest value in the brick
+  float min;
+
+  //! The largest value in the brick
+  float max;
+};
+
+//! Return whether the given file starts like a bricked volume
+bool is_bricked_volume(const char* filename);
+
+//! Stream a volume plane by plane into a bricked file
+/*! Planes are collected until a full slab of bricks is available. The
+ *  bricks of the slab are then encoded in parallel and appended to the
+ *  output in order.
+ */
+class BrickedWriter : public VolumeOutput
+{
+public:
+
+  //! Constructor
+  /*!
+   * @param dim The dimensions of the volume
+   * @param brick_size The edge length of a brick
+   * @param quantizer The quantizer to encode values with or NULL to store floats
+   * @param metric The name of the metric
+   * @param tree_type The tree type used
+   * @param threshold The threshold used
+   * @param fill The value of unlabeled vertices
+   */
+  BrickedWriter(const GlobalIndexType dim[3], uint32_t brick_size, const Quantizer* quantizer,
+                const char* metric, int tree_type, FunctionType threshold, FunctionType fill);
+
+  //! Destructor
+  virtual ~BrickedWriter() {}
+
+  //! Open the file and write the header
+  virtual int open(const char* filename, bool direct=false);
+
+  //! Add the next plane of dim[0]*dim[1] values
+  virtual int writePlane(const FunctionType* plane, const LocalIndexType* labels);
+
+  //! Write the index and the trailer and close the file
+  virtual int close();
+
+private:
+
+  //! The header
+  BrickedHeader mHeader;
+
+  //! The quantization used if the header says so
+  Quantizer mQuantizer;
+
+  //! The planes of the current slab
+  std::vector<FunctionType> mSlab;
+
+  //! The number of planes written so far
+  uint32_t mPlanes;
+
+  //! The index of all bricks written so far
+  std::vector<BrickEntry> mIndex;
+
+  //! Encode and write all bricks of the current slab
+  int flushSlab();
+};
+
+//! Random access to the bricks of a bricked volume
+class BrickedReader
+{
+public:
+
+  //! Default constructor
+  BrickedReader() : mFile(-1) {}
+
+  //! Destructor
+  ~BrickedReader();
+
+  //! Open the file and read its header and index
+  int open(const char* filename);
+
+  //! Return the header
+  const BrickedHeader& header() const {return mHeader;}
+
+  //! Return the number of bricks
+  uint32_t brickCount() const {return (uint32_t)mIndex.size();}
+
+  //! Return the index entry of the given brick
+  const BrickEntry& entry(uint32_t brick) const {return mIndex[brick];}
+
+  //! Collect all bricks with a maximum of at least the given value
+  void query(FunctionType cutoff, std::vector<uint32_t>& bricks) const;
+
+  //! Read and decode the values of the given brick
+  /*! The values are stored in x-fastest order of the brick's extent as
+   *  returned by brick_box
+   */
+  int readBrick(uint32_t brick, std::vector<FunctionType>& values) const;
+
+private:
+
+  //! The file descriptor
+  int mFile;
+
+  //! The header
+  BrickedHeader mHeader;
+
+  //! The quantization if the file is quantized
+  Quantizer mQuantizer;
+
+  //! The brick index
+  std::vector<BrickEntry> mIndex;
+};
+
+
+#endif /* BRICKEDVOLUME_H_ */
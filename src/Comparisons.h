@@ -111,17 +111,17 @@ public:
   ~IndexComp() {}
 
   //! Comparing two indices of a scalar field.
-  /*! Compare the function value at two indices of a scalar field. Note
-   *  that for efficiency reasons this does not explicitly tests for f(i) == f(j).
-   *  However, the was the algorithm uses the copmarison and because stl::sort is stable
-   *  we implicitly maintain the default SoS i < j
+  /*! Compare the function value at two indices of a scalar field. Ties
+   *  are broken explicitly by index (simulation of simplicity with i < j)
+   *  since std::sort is not stable. This makes the order independent of
+   *  the sorting algorithm used.
    *
    * @param i index 1
    * @param j index 2
    * @return 1 if f(i) < f(j) 0 otherwise
    */
   bool operator()(const GlobalIndexType& i, const GlobalIndexType& j) const {
-    return mComp(mData[i],mData[j]);
+    return mComp(mData[i],mData[j]) || ((mData[i] == mData[j]) && (i < j));
   }
 
 private:
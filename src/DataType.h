@@ -0,0 +1,138 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef DATATYPE_H
+#define DATATYPE_H
+
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+//! Number of supported input data types
+#define NUM_DATA_TYPES 6
+
+//! Enum of the supported element types of raw input files
+enum DataType {
+  DATA_UINT8 = 0,
+  DATA_UINT16 = 1,
+  DATA_INT32 = 2,
+  DATA_FLOAT16 = 3,
+  DATA_FLOAT32 = 4,
+  DATA_DOUBLE = 5,
+};
+
+//! Return the command line name of the given type
+inline const char* data_type_name(DataType type)
+{
+  static const char* names[NUM_DATA_TYPES] = {
+      "uint8",
+      "uint16",
+      "int32",
+      "float16",
+      "float32",
+      "double",
+  };
+
+  return names[type];
+}
+
+//! Return the size of a single element of the given type in bytes
+inline size_t data_type_size(DataType type)
+{
+  static const size_t sizes[NUM_DATA_TYPES] = {1,2,4,2,4,8};
+
+  return sizes[type];
+}
+
+//! Convert a name into a type
+/*! @return 1 if the name is a valid type 0 otherwise */
+inline int parse_data_type(const char* name, DataType& type)
+{
+  for (int i=0;i<NUM_DATA_TYPES;i++) {
+    if (strcmp(name,data_type_name((DataType)i)) == 0) {
+      type = (DataType)i;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+//! Return the number of distinct values of integer types with a small domain
+/*! Values of these types can be used directly as bucket indices, all
+ *  other types return 0.
+ */
+inline uint32_t data_type_domain(DataType type)
+{
+  switch (type) {
+    case DATA_UINT8:
+      return 1 << 8;
+    case DATA_UINT16:
+      return 1 << 16;
+    default:
+      return 0;
+  }
+}
+
+
+#endif /* DATATYPE_H_ */
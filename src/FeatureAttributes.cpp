@@ -0,0 +1,355 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stack>
+#include <unordered_map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "FeatureAttributes.h"
+
+//! The identifier at the beginning of an attribute table
+static const char gAttributeMagic[4] = {'A','D','A','T'};
+
+//! The version of the attribute table
+static const uint32_t gAttributeVersion = 1;
+
+//! The fixed size record written for each node of the tree
+struct AttributeRecord
+{
+  uint64_t count;
+  uint32_t down;
+  float mean;
+  float variance;
+  float min;
+  float max;
+  uint32_t low[3];
+  uint32_t high[3];
+  float centroid[3];
+};
+
+Attribute::Attribute() : mCount(0), mSum(0), mMean(0), mM2(0),
+    mMin(std::numeric_limits<FunctionType>::max()),
+    mMax(std::numeric_limits<FunctionType>::lowest())
+{
+  for (int i=0;i<3;i++) {
+    mLow[i] = (uint32_t)(-1);
+    mHigh[i] = 0;
+    mCoordSum[i] = 0;
+  }
+}
+
+void Attribute::addVertex(uint32_t x, uint32_t y, uint32_t z, FunctionType f)
+{
+  double delta;
+
+  // Welford's update of the mean and the squared deviations
+  mCount++;
+  delta = f - mMean;
+  mMean += delta / mCount;
+  mM2 += delta * (f - mMean);
+  mSum += f;
+
+  mMin = std::min(mMin,f);
+  mMax = std::max(mMax,f);
+
+  mLow[0] = std::min(mLow[0],x);
+  mLow[1] = std::min(mLow[1],y);
+  mLow[2] = std::min(mLow[2],z);
+
+  mHigh[0] = std::max(mHigh[0],x);
+  mHigh[1] = std::max(mHigh[1],y);
+  mHigh[2] = std::max(mHigh[2],z);
+
+  mCoordSum[0] += x;
+  mCoordSum[1] += y;
+  mCoordSum[2] += z;
+}
+
+void Attribute::translate(const GlobalIndexType offset[3])
+{
+  // Empty sets keep their inverted bounding box
+  if (mCount == 0)
+    return;
+
+  for (int i=0;i<3;i++) {
+    mLow[i] += offset[i];
+    mHigh[i] += offset[i];
+    mCoordSum[i] += (double)offset[i]*mCount;
+  }
+}
+
+void Attribute::merge(const Attribute& a)
+{
+  if (a.mCount == 0)
+    return;
+
+  if (mCount == 0) {
+    *this = a;
+    return;
+  }
+
+  // Pairwise combination of the moments (Chan et al.)
+  double n = (double)mCount + (double)a.mCount;
+  double delta = a.mMean - mMean;
+
+  mM2 += a.mM2 + delta*delta*((double)mCount*(double)a.mCount / n);
+  mMean += delta * (a.mCount / n);
+  mCount += a.mCount;
+  mSum += a.mSum;
+
+  mMin = std::min(mMin,a.mMin);
+  mMax = std::max(mMax,a.mMax);
+
+  for (int i=0;i<3;i++) {
+    mLow[i] = std::min(mLow[i],a.mLow[i]);
+    mHigh[i] = std::max(mHigh[i],a.mHigh[i]);
+    mCoordSum[i] += a.mCoordSum[i];
+  }
+}
+
+int FeatureAttributes::computeFromLabels(const MergeTree& tree, const LocalIndexType* labels,
+                                         const FunctionType* data, const GlobalIndexType dim[3])
+{
+  int thread_count = 1;
+#ifdef _OPENMP
+  thread_count = omp_get_max_threads();
+#endif
+
+  // Every thread accumulates the statistics of only the arcs it encounters
+  // in its slabs, indexed through a map from labels to its local entries
+  std::vector<std::vector<Attribute> > local(thread_count);
+  std::vector<std::unordered_map<LocalIndexType,LocalIndexType> > index(thread_count);
+
+#pragma omp parallel num_threads(thread_count)
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    std::vector<Attribute>& acc = local[t];
+    std::unordered_map<LocalIndexType,LocalIndexType>& map = index[t];
+    LocalIndexType last = LNULL;
+    LocalIndexType entry = 0;
+
+#pragma omp for schedule(static)
+    for (int64_t z=0;z<(int64_t)dim[2];z++) {
+      GlobalIndexType v = z*dim[0]*dim[1];
+
+      for (uint32_t y=0;y<dim[1];y++) {
+        for (uint32_t x=0;x<dim[0];x++,v++) {
+          if (labels[v] == LNULL)
+            continue;
+
+          assert(labels[v] < tree.size());
+
+          // Neighboring vertices mostly share their label
+          if (labels[v] != last) {
+            last = labels[v];
+
+            std::unordered_map<LocalIndexType,LocalIndexType>::iterator it = map.find(last);
+            if (it == map.end()) {
+              entry = (LocalIndexType)acc.size();
+              map[last] = entry;
+              acc.push_back(Attribute());
+            }
+            else
+              entry = it->second;
+          }
+
+          acc[entry].addVertex(x,y,(uint32_t)z,data[v]);
+        }
+      }
+    }
+  }
+
+  // Now combine the per-thread statistics in the order of the threads
+  mArcs.assign(tree.size(),Attribute());
+
+  for (int t=0;t<thread_count;t++) {
+    std::unordered_map<LocalIndexType,LocalIndexType>::const_iterator it;
+
+    for (it=index[t].begin();it!=index[t].end();it++)
+      mArcs[it->first].merge(local[t][it->second]);
+
+    std::vector<Attribute>().swap(local[t]);
+  }
+
+  return 1;
+}
+
+int FeatureAttributes::computeFromArcs(const MergeTree& tree, const FunctionType* data,
+                                       const GlobalIndexType dim[3])
+{
+  mArcs.assign(tree.size(),Attribute());
+
+  // Arcs are disjoint so each can be processed independently
+#pragma omp parallel for schedule(dynamic,64)
+  for (int64_t i=0;i<(int64_t)tree.size();i++) {
+    const GlobalIndexType* vertices = tree.arcBegin(i);
+
+    for (GlobalIndexType k=0;k<tree.arcSize(i);k++) {
+      GlobalIndexType v = vertices[k];
+
+      mArcs[i].addVertex(v % dim[0],(v / dim[0]) % dim[1],v / (dim[0]*dim[1]),data[v]);
+    }
+  }
+
+  return 1;
+}
+
+int FeatureAttributes::accumulate(const MergeTree& tree)
+{
+  std::vector<LocalIndexType> order;
+  std::stack<LocalIndexType> front;
+  LocalIndexType top,up;
+
+  assert(mArcs.size() == tree.size());
+
+  order.reserve(tree.size());
+
+  // Collect all nodes in pre-order starting from the roots so that every
+  // node appears before all nodes in its subtree
+  for (LocalIndexType i=0;i<tree.size();i++) {
+    if (tree.node(i).down() == LNULL) {
+      front.push(i);
+
+      while (!front.empty()) {
+        top = front.top();
+        front.pop();
+        order.push_back(top);
+
+        up = tree.node(top).up();
+        if (up != LNULL) {
+          do {
+            front.push(up);
+            up = tree.node(up).next();
+          } while (up != tree.node(top).up());
+        }
+      }
+    }
+  }
+
+  mSubtrees = mArcs;
+
+  // Traversing the pre-order backwards guarantees that a subtree is
+  // complete before it is passed on to its parent
+  for (std::vector<LocalIndexType>::reverse_iterator it=order.rbegin();it!=order.rend();it++) {
+    if (tree.node(*it).down() != LNULL)
+      mSubtrees[tree.node(*it).down()].merge(mSubtrees[*it]);
+  }
+
+  return 1;
+}
+
+void FeatureAttributes::translate(const GlobalIndexType offset[3])
+{
+  for (LocalIndexType i=0;i<mArcs.size();i++)
+    mArcs[i].translate(offset);
+
+  for (LocalIndexType i=0;i<mSubtrees.size();i++)
+    mSubtrees[i].translate(offset);
+}
+
+int FeatureAttributes::write(FILE* output, const MergeTree& tree) const
+{
+  uint32_t count = (uint32_t)mSubtrees.size();
+  AttributeRecord record;
+
+  assert(mSubtrees.size() == tree.size());
+
+  if ((fwrite(gAttributeMagic,sizeof(char),4,output) != 4)
+      || (fwrite(&gAttributeVersion,sizeof(uint32_t),1,output) != 1)
+      || (fwrite(&count,sizeof(uint32_t),1,output) != 1)) {
+    fprintf(stderr,"Error, could not write attribute header\n");
+    return 0;
+  }
+
+  for (LocalIndexType i=0;i<mSubtrees.size();i++) {
+    const Attribute& a = mSubtrees[i];
+
+    record.count = a.mCount;
+    record.down = tree.node(i).down();
+    record.mean = (float)a.mMean;
+    record.variance = (float)a.variance();
+    record.min = (float)a.mMin;
+    record.max = (float)a.mMax;
+    for (int k=0;k<3;k++) {
+      record.low[k] = a.mLow[k];
+      record.high[k] = a.mHigh[k];
+      record.centroid[k] = (float)a.centroid(k);
+    }
+
+    if (fwrite(&record,sizeof(AttributeRecord),1,output) != 1) {
+      fprintf(stderr,"Error, could not write attribute table\n");
+      return 0;
+    }
+  }
+
+  return 1;
+}
@@ -0,0 +1,188 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef FEATUREATTRIBUTES_H
+#define FEATUREATTRIBUTES_H
+
+#include <cstdio>
+#include <vector>
+
+#include "Definitions.h"
+#include "MergeTree.h"
+
+//! A set of mergeable statistics of a collection of vertices
+/*! All members are chosen such that the statistics of the union of two
+ *  disjoint sets can be computed from the statistics of the two sets
+ *  alone. The moments are kept as mean and sum of squared deviations
+ *  to allow a numerically stable pairwise combination.
+ */
+class Attribute
+{
+public:
+
+  //! Default constructor creating an empty set
+  Attribute();
+
+  //! Add a single vertex with the given coordinates and function value
+  void addVertex(uint32_t x, uint32_t y, uint32_t z, FunctionType f);
+
+  //! Combine the statistics of another (disjoint) set into this one
+  void merge(const Attribute& a);
+
+  //! Shift all coordinates by the given offset
+  void translate(const GlobalIndexType offset[3]);
+
+  //! Return the variance of the function values
+  double variance() const {return (mCount > 0) ? mM2 / mCount : 0;}
+
+  //! Return the i'th coordinate of the centroid
+  double centroid(int i) const {return (mCount > 0) ? mCoordSum[i] / mCount : 0;}
+
+  //! The number of vertices
+  GlobalIndexType mCount;
+
+  //! The sum of all function values
+  double mSum;
+
+  //! The mean function value
+  double mMean;
+
+  //! The sum of squared deviations from the mean
+  double mM2;
+
+  //! The smallest function value
+  FunctionType mMin;
+
+  //! The largest function value
+  FunctionType mMax;
+
+  //! The lower corner of the bounding box
+  uint32_t mLow[3];
+
+  //! The upper corner of the bounding box
+  uint32_t mHigh[3];
+
+  //! The sum of all coordinates
+  double mCoordSum[3];
+};
+
+//! Per-arc and per-subtree attributes of a merge tree
+/*! The attributes are computed in two stages. First, the statistics of
+ *  all arcs are accumulated in a single (parallel) pass over either the
+ *  labels volume or the augmented arcs. Second, the arc statistics are
+ *  combined bottom-up along the tree to form the statistics of each
+ *  subtree, i.e. of the feature represented by each node.
+ */
+class FeatureAttributes
+{
+public:
+
+  //! Default constructor
+  FeatureAttributes() {}
+
+  //! Destructor
+  ~FeatureAttributes() {}
+
+  //! Return the number of nodes
+  LocalIndexType size() const {return (LocalIndexType)mArcs.size();}
+
+  //! Return the attributes of the i'th arc
+  const Attribute& arc(LocalIndexType i) const {return mArcs[i];}
+
+  //! Return the attributes of the subtree rooted at the i'th node
+  const Attribute& subtree(LocalIndexType i) const {return mSubtrees[i];}
+
+  //! Accumulate the arc statistics from the labels volume
+  int computeFromLabels(const MergeTree& tree, const LocalIndexType* labels,
+                        const FunctionType* data, const GlobalIndexType dim[3]);
+
+  //! Accumulate the arc statistics from the explicit arcs of an augmented tree
+  int computeFromArcs(const MergeTree& tree, const FunctionType* data,
+                      const GlobalIndexType dim[3]);
+
+  //! Combine the arc statistics bottom-up into subtree statistics
+  int accumulate(const MergeTree& tree);
+
+  //! Shift all coordinates, e.g. from a region of interest into the full volume
+  void translate(const GlobalIndexType offset[3]);
+
+  //! Write the subtree statistics as a binary table
+  /*! The table starts with the four characters "ADAT" followed by a
+   *  uint32 version and a uint32 node count. Each node is then stored as
+   *  a 64 byte record: uint64 count, uint32 down, float mean, variance,
+   *  min and max, uint32 bounding box low[3] and high[3], and float
+   *  centroid[3].
+   */
+  int write(FILE* output, const MergeTree& tree) const;
+
+private:
+
+  //! The statistics of the individual arcs
+  std::vector<Attribute> mArcs;
+
+  //! The statistics of the subtrees
+  std::vector<Attribute> mSubtrees;
+};
+
+
+#endif /* FEATUREATTRIBUTES_H_ */
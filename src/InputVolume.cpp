@@ -0,0 +1,664 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "InputVolume.h"
+#include "BrickedVolume.h"
+
+//! The size of the individual pread requests
+static const size_t gReadChunkSize = 64 << 20;
+
+//! Reverse the byte order of a value
+inline uint8_t byte_swap(uint8_t v) {return v;}
+inline uint16_t byte_swap(uint16_t v) {return __builtin_bswap16(v);}
+inline uint32_t byte_swap(uint32_t v) {return __builtin_bswap32(v);}
+inline uint64_t byte_swap(uint64_t v) {return __builtin_bswap64(v);}
+
+//! Convert an IEEE half precision number stored as uint16 into a float
+inline float half_to_float(uint16_t h)
+{
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1f;
+  uint32_t mantissa = h & 0x3ff;
+  uint32_t bits;
+
+  if (exponent == 0x1f) // Inf and NaN
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  else if (exponent != 0) // Normalized numbers
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  else if (mantissa == 0) // Signed zero
+    bits = sign;
+  else { // Denormals become normalized floats
+    exponent = 113;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+
+  float f;
+  memcpy(&f,&bits,sizeof(float));
+  return f;
+}
+
+//! Convert count elements of type T into FunctionType
+/*! The raw bytes are reinterpreted as the unsigned integer type U of the
+ *  same size, optionally byte swapped and then converted to T and
+ *  FunctionType. Consecutive elements are stride elements apart which
+ *  deinterleaves one component of interleaved data. The loops are kept
+ *  free of branches so the compiler can vectorize them.
+ * @return The number of values that FunctionType cannot represent exactly
+ */
+template <typename T, typename U>
+static size_t convert(const char* src, FunctionType* dst, size_t count, bool swap, size_t stride)
+{
+  U bits;
+  T value;
+  size_t lossy = 0;
+
+  if (swap) {
+    for (size_t i=0;i<count;i++) {
+      memcpy(&bits,src + i*stride*sizeof(U),sizeof(U));
+      bits = byte_swap(bits);
+      memcpy(&value,&bits,sizeof(T));
+      dst[i] = (FunctionType)value;
+      lossy += ((double)dst[i] != (double)value) && (value == value);
+    }
+  }
+  else if (stride == 1) {
+    for (size_t i=0;i<count;i++) {
+      memcpy(&value,src + i*sizeof(T),sizeof(T));
+      dst[i] = (FunctionType)value;
+      lossy += ((double)dst[i] != (double)value) && (value == value);
+    }
+  }
+  else {
+    for (size_t i=0;i<count;i++) {
+      memcpy(&value,src + i*stride*sizeof(T),sizeof(T));
+      dst[i] = (FunctionType)value;
+      lossy += ((double)dst[i] != (double)value) && (value == value);
+    }
+  }
+
+  return lossy;
+}
+
+//! Convert count half precision values into FunctionType
+static void convert_half(const char* src, FunctionType* dst, size_t count, bool swap, size_t stride)
+{
+  uint16_t bits;
+
+  for (size_t i=0;i<count;i++) {
+    memcpy(&bits,src + i*stride*sizeof(uint16_t),sizeof(uint16_t));
+    if (swap)
+      bits = byte_swap(bits);
+    dst[i] = (FunctionType)half_to_float(bits);
+  }
+}
+
+//! Convert count raw elements of the given type into FunctionType
+/*! @return The number of values that FunctionType cannot represent exactly
+ */
+static size_t convert(DataType type, const char* src, FunctionType* dst, size_t count, bool swap,
+                      size_t stride=1)
+{
+  switch (type) {
+    case DATA_UINT8:
+      return convert<uint8_t,uint8_t>(src,dst,count,swap,stride);
+    case DATA_UINT16:
+      return convert<uint16_t,uint16_t>(src,dst,count,swap,stride);
+    case DATA_INT32:
+      return convert<int32_t,uint32_t>(src,dst,count,swap,stride);
+    case DATA_FLOAT16:
+      convert_half(src,dst,count,swap,stride);
+      return 0;
+    case DATA_FLOAT32:
+      return convert<float,uint32_t>(src,dst,count,swap,stride);
+    case DATA_DOUBLE:
+      return convert<double,uint64_t>(src,dst,count,swap,stride);
+  }
+
+  return 0;
+}
+
+//! Warn if values have been rounded while converting them to FunctionType
+static void report_lossy(DataType type, size_t lossy)
+{
+  if (lossy > 0)
+    fprintf(stderr,"Warning, %zu %s values have been rounded to float which may change their order and the tree\n",
+            lossy,data_type_name(type));
+}
+
+InputVolume::InputVolume() : mData(NULL), mMapping(NULL), mMappingSize(0), mBuffer(NULL),
+                             mCapacity(0)
+{
+}
+
+InputVolume::~InputVolume()
+{
+  clear();
+}
+
+void InputVolume::clear()
+{
+  unmap();
+
+  delete[] mBuffer;
+
+  mData = NULL;
+  mBuffer = NULL;
+  mCapacity = 0;
+}
+
+void InputVolume::reset()
+{
+  unmap();
+
+  mData = NULL;
+}
+
+FunctionType* InputVolume::allocate(size_t count)
+{
+  if (count > mCapacity) {
+    delete[] mBuffer;
+    mBuffer = new FunctionType[count];
+    mCapacity = count;
+  }
+
+  return mBuffer;
+}
+
+void InputVolume::unmap()
+{
+  if (mMapping != NULL)
+    munmap(mMapping,mMappingSize);
+
+  mMapping = NULL;
+  mMappingSize = 0;
+}
+
+int InputVolume::read(const char* filename, const GlobalIndexType dim[3], DataType type,
+                      bool swap, bool use_mmap, const InputLayout& layout)
+{
+  struct stat info;
+  size_t count = dim[0]*dim[1]*dim[2];
+  size_t element = data_type_size(type);
+  size_t bytes = layout.mOffset + count*layout.mStride*element;
+
+  // Only contiguous native floats can be used in place, everything else
+  // is converted
+  bool native = (sizeof(FunctionType) == sizeof(float)) && (type == DATA_FLOAT32) && !swap
+                && (layout.mStride == 1);
+
+  if (layout.mComponent >= layout.mStride) {
+    fprintf(stderr,"Error, component %u does not exist for a stride of %u\n",
+            layout.mComponent,layout.mStride);
+    return 0;
+  }
+
+  reset();
+
+  int fd = openFile(filename,bytes,info);
+  if (fd < 0)
+    return 0;
+
+  // Only regular files can be mapped. Everything else (pipes, devices, ...)
+  // is read sequentially
+  if (use_mmap && S_ISREG(info.st_mode) && (map(fd,bytes) == 1)) {
+    const char* first_value = (const char*)mMapping + layout.mOffset + layout.mComponent*element;
+
+    // Contiguous and aligned floats are used in place. Everything else is
+    // gathered from the mapping so only the pages holding the requested
+    // values are touched and only those values are copied
+    if (native && ((layout.mOffset % sizeof(FunctionType)) == 0))
+      mData = (const FunctionType*)first_value;
+    else {
+      size_t chunk = std::max(gReadChunkSize / (layout.mStride*element),(size_t)1);
+
+      size_t lossy = 0;
+
+      allocate(count);
+
+#pragma omp parallel for schedule(static) reduction(+:lossy)
+      for (int64_t c=0;c<(int64_t)((count + chunk - 1) / chunk);c++) {
+        size_t first = c*chunk;
+        size_t last = std::min(first + chunk,count);
+
+        lossy += convert(type,first_value + first*layout.mStride*element,mBuffer + first,last - first,
+                         swap,layout.mStride);
+      }
+
+      report_lossy(type,lossy);
+      unmap();
+      mData = mBuffer;
+    }
+  }
+  else if (load(fd,count,type,swap,S_ISREG(info.st_mode),layout) == 0) {
+    close(fd);
+    return 0;
+  }
+
+  // A mapping remains valid after the descriptor is closed
+  close(fd);
+
+  return 1;
+}
+
+int InputVolume::readRegion(const char* filename, const GlobalIndexType dim[3], const GlobalIndexType low[3],
+                            const GlobalIndexType high[3], DataType type, bool swap,
+                            const InputLayout& layout)
+{
+  struct stat info;
+  size_t element = data_type_size(type);
+  size_t record = layout.mStride*element;
+  bool native = (sizeof(FunctionType) == element) && (type == DATA_FLOAT32) && !swap
+                && (layout.mStride == 1);
+
+  for (int i=0;i<3;i++) {
+    if ((low[i] >= high[i]) || (high[i] > dim[i])) {
+      fprintf(stderr,"Error, the region [%llu,%llu) is empty or exceeds the dimension %llu\n",
+              (unsigned long long)low[i],(unsigned long long)high[i],(unsigned long long)dim[i]);
+      return 0;
+    }
+  }
+
+  if (layout.mComponent >= layout.mStride) {
+    fprintf(stderr,"Error, component %u does not exist for a stride of %u\n",
+            layout.mComponent,layout.mStride);
+    return 0;
+  }
+
+  reset();
+
+  int fd = openFile(filename,layout.mOffset + dim[0]*dim[1]*dim[2]*record,info);
+  if (fd < 0)
+    return 0;
+
+  if (!S_ISREG(info.st_mode)) {
+    fprintf(stderr,"Error, a region can only be read from a regular file\n");
+    close(fd);
+    return 0;
+  }
+
+  size_t width = high[0] - low[0];
+  size_t height = high[1] - low[1];
+  size_t depth = high[2] - low[2];
+
+  // A box spanning the full width is contiguous within each plane and a
+  // box spanning full planes is contiguous overall, so we read the
+  // largest contiguous spans possible
+  size_t span = width;
+  size_t spans_per_plane = height;
+  if (width == dim[0]) {
+    span *= height;
+    spans_per_plane = 1;
+    if (height == dim[1]) {
+      span *= depth;
+      depth = 1;
+    }
+  }
+
+  // Long spans are split into chunks so that large contiguous regions are
+  // still read in parallel and the staging buffers stay small
+  size_t chunk = std::min(std::max(gReadChunkSize / record,(size_t)1),span);
+  size_t chunks_per_span = (span + chunk - 1) / chunk;
+  int64_t chunks = (int64_t)(spans_per_plane*depth*chunks_per_span);
+  int failed = 0;
+  size_t lossy = 0;
+
+  allocate(width*height*(high[2] - low[2]));
+
+#pragma omp parallel reduction(+:failed) reduction(+:lossy)
+  {
+    std::vector<char> staging(native ? 0 : chunk*record);
+
+#pragma omp for schedule(dynamic,16)
+    for (int64_t c=0;c<chunks;c++) {
+      size_t s = c / chunks_per_span;
+      size_t first = (c % chunks_per_span)*chunk;
+      size_t last = std::min(first + chunk,span);
+      size_t y = low[1] + (s % spans_per_plane);
+      size_t z = low[2] + (s / spans_per_plane);
+      size_t offset = layout.mOffset + ((z*dim[1] + y)*dim[0] + low[0] + first)*record;
+      size_t bytes = (last - first)*record;
+      char* dst = native ? (char*)(mBuffer + s*span + first) : &staging[0];
+      size_t pos = 0;
+
+      while (pos < bytes) {
+        ssize_t n = pread(fd,dst + pos,bytes - pos,offset + pos);
+
+        if ((n < 0) && (errno == EINTR))
+          continue;
+
+        if (n <= 0) {
+          failed++;
+          break;
+        }
+        pos += n;
+      }
+
+      if (!native && (pos == bytes))
+        lossy += convert(type,dst + layout.mComponent*element,mBuffer + s*span + first,last - first,
+                         swap,layout.mStride);
+    }
+  }
+
+  close(fd);
+
+  if (failed > 0) {
+    fprintf(stderr,"Error, could not read the input region\n");
+    clear();
+    return 0;
+  }
+
+  report_lossy(type,lossy);
+
+  mData = mBuffer;
+
+  return 1;
+}
+
+int InputVolume::readBricked(const char* filename, const Comparison& greater, FunctionType threshold,
+                             GlobalIndexType dim[3], BrickIndex& index, DataType& type)
+{
+  BrickedReader reader;
+
+  reset();
+
+  if (reader.open(filename) == 0)
+    return 0;
+
+  const BrickedHeader& header = reader.header();
+
+  dim[0] = header.dim[0];
+  dim[1] = header.dim[1];
+  dim[2] = header.dim[2];
+
+  // Integers stored without scaling keep their type
+  type = DATA_FLOAT32;
+  if ((header.dataType != DATA_FLOAT32) && (header.offset == 0) && (header.scale == 1))
+    type = (DataType)header.dataType;
+
+  index.initialize(dim,header.brickSize);
+  for (uint32_t b=0;b<reader.brickCount();b++)
+    index.range(b,reader.entry(b).min,reader.entry(b).max);
+  index.buildHierarchy();
+
+  std::vector<char> active;
+  uint32_t active_count = index.activeBricks(greater,threshold,active);
+
+  allocate(dim[0]*dim[1]*dim[2]);
+
+  int failed = 0;
+
+#pragma omp parallel for schedule(dynamic,1) reduction(+:failed)
+  for (int64_t b=0;b<(int64_t)index.brickCount();b++) {
+    std::vector<FunctionType> values;
+    uint32_t low[3],high[3];
+    bool skip = !active[b];
+    FunctionType lowest = index.lowest(b,greater);
+    size_t k = 0;
+
+    if (!skip && (reader.readBrick(b,values) == 0)) {
+      failed++;
+      continue;
+    }
+
+    index.box(b,low,high);
+    for (uint32_t z=low[2];z<high[2];z++) {
+      for (uint32_t y=low[1];y<high[1];y++) {
+        FunctionType* row = mBuffer + (z*dim[1] + y)*dim[0];
+
+        if (skip)
+          std::fill(row + low[0],row + high[0],lowest);
+        else {
+          std::copy(&values[k],&values[k] + (high[0] - low[0]),row + low[0]);
+          k += high[0] - low[0];
+        }
+      }
+    }
+  }
+
+  if (failed > 0) {
+    fprintf(stderr,"Error, could not read the bricks of \"%s\"\n",filename);
+    clear();
+    return 0;
+  }
+
+  fprintf(stderr,"Read %u of %u bricks\n",active_count,index.brickCount());
+
+  mData = mBuffer;
+
+  return 1;
+}
+
+int InputVolume::openFile(const char* filename, size_t bytes, struct stat& info)
+{
+  int fd = open(filename,O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr,"Error, could not open input file \"%s\": %s\n",filename,strerror(errno));
+    return -1;
+  }
+
+  if (fstat(fd,&info) != 0) {
+    fprintf(stderr,"Error, could not stat input file \"%s\": %s\n",filename,strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  // The size of pipes and devices is unknown
+  if (S_ISREG(info.st_mode) && ((size_t)info.st_size < bytes)) {
+    fprintf(stderr,"Error, input file \"%s\" contains %zu bytes but needs %zu\n",
+            filename,(size_t)info.st_size,bytes);
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int InputVolume::map(int fd, size_t bytes)
+{
+  void* mapping = mmap(NULL,bytes,PROT_READ,MAP_SHARED,fd,0);
+
+  if (mapping == MAP_FAILED)
+    return 0;
+
+  // The screening pass reads everything once but the sweep and the metric
+  // evaluation revisit the data in random order. So we ask for the whole
+  // file to be paged in early rather than for sequential read-ahead, which
+  // would drop pages behind the screening.
+  madvise(mapping,bytes,MADV_WILLNEED);
+
+  mMapping = mapping;
+  mMappingSize = bytes;
+
+  return 1;
+}
+
+//! Read exactly the given number of bytes from a stream
+static int read_fully(int fd, char* dst, size_t bytes)
+{
+  size_t pos = 0;
+
+  while (pos < bytes) {
+    ssize_t n = ::read(fd,dst + pos,bytes - pos);
+
+    if ((n < 0) && (errno == EINTR))
+      continue;
+
+    if (n <= 0)
+      return 0;
+
+    pos += n;
+  }
+
+  return 1;
+}
+
+int InputVolume::load(int fd, size_t count, DataType type, bool swap, bool seekable,
+                      const InputLayout& layout)
+{
+  size_t element = data_type_size(type);
+  size_t record = layout.mStride*element;
+  bool native = (sizeof(FunctionType) == element) && (type == DATA_FLOAT32) && !swap
+                && (layout.mStride == 1);
+
+  allocate(count);
+
+  // Native data is read straight into the buffer, everything else goes
+  // through a staging buffer of at most one chunk per thread. Chunks
+  // always contain complete records of interleaved data
+  size_t chunk = std::max(gReadChunkSize / record,(size_t)1);
+  int64_t chunks = (int64_t)((count + chunk - 1) / chunk);
+  int failed = 0;
+  size_t lossy = 0;
+
+  // Streams that do not support pread are read sequentially
+  if (!seekable) {
+    std::vector<char> staging(native ? std::min(layout.mOffset,gReadChunkSize) : chunk*record);
+    size_t skipped = 0;
+
+    // Skip everything in front of the first value
+    while ((skipped < layout.mOffset) && (failed == 0)) {
+      size_t n = std::min(layout.mOffset - skipped,staging.size());
+
+      if (read_fully(fd,&staging[0],n) == 0)
+        failed++;
+      skipped += n;
+    }
+
+    for (int64_t c=0;(c<chunks) && (failed == 0);c++) {
+      size_t first = c*chunk;
+      size_t last = std::min(first + chunk,count);
+      char* dst = native ? (char*)(mBuffer + first) : &staging[0];
+
+      if (read_fully(fd,dst,(last - first)*record) == 0) {
+        fprintf(stderr,"Error, input ended before %zu of %zu values were read\n",last,count);
+        failed++;
+      }
+      else if (!native)
+        lossy += convert(type,dst + layout.mComponent*element,mBuffer + first,last - first,swap,
+                         layout.mStride);
+    }
+  }
+  else {
+
+    // Independent chunks are read with pread so threads do not share a
+    // file offset
+#pragma omp parallel reduction(+:failed) reduction(+:lossy)
+    {
+      std::vector<char> staging(native ? 0 : chunk*record);
+
+#pragma omp for schedule(dynamic,1)
+      for (int64_t c=0;c<chunks;c++) {
+        size_t first = c*chunk;
+        size_t last = std::min(first + chunk,count);
+        size_t offset = layout.mOffset + first*record;
+        size_t bytes = (last - first)*record;
+        char* dst = native ? (char*)(mBuffer + first) : &staging[0];
+        size_t pos = 0;
+
+        while (pos < bytes) {
+          ssize_t n = pread(fd,dst + pos,bytes - pos,offset + pos);
+
+          if ((n < 0) && (errno == EINTR))
+            continue;
+
+          if (n <= 0) {
+            failed++;
+            break;
+          }
+          pos += n;
+        }
+
+        if (!native && (pos == bytes))
+          lossy += convert(type,dst + layout.mComponent*element,mBuffer + first,last - first,swap,
+                           layout.mStride);
+      }
+    }
+
+    if (failed > 0)
+      fprintf(stderr,"Error, could not read the input data\n");
+  }
+
+  if (failed > 0) {
+    clear();
+    return 0;
+  }
+
+  report_lossy(type,lossy);
+  mData = mBuffer;
+
+  return 1;
+}
@@ -0,0 +1,221 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef INPUTVOLUME_H
+#define INPUTVOLUME_H
+
+#include <cstddef>
+#include <sys/stat.h>
+
+#include "Definitions.h"
+#include "DataType.h"
+#include "BrickIndex.h"
+
+//! Description of where the values of a volume are stored within a file
+/*! The i'th value of the volume is stored at byte
+ *  mOffset + (i*mStride + mComponent)*sizeof(type). A stride larger
+ *  than one selects a single variable of interleaved (array of structs)
+ *  data while the offset skips headers or preceding variable blocks.
+ */
+class InputLayout
+{
+public:
+
+  //! Default constructor describing a single contiguous field
+  InputLayout() : mOffset(0), mStride(1), mComponent(0) {}
+
+  //! The byte offset of the first record
+  size_t mOffset;
+
+  //! The number of values stored per voxel
+  uint32_t mStride;
+
+  //! The index of the requested value within each voxel
+  uint32_t mComponent;
+};
+
+//! Read-only access to a raw volume stored on disk
+/*! The volume is preferably memory mapped read-only in which case data()
+ *  points directly into the page cache and no additional copy is made.
+ *  Strided values are gathered from the mapping into a private buffer.
+ *  If the file cannot be mapped (or mapping has been disabled) the data
+ *  is read into a private buffer using parallel pread calls instead.
+ *  Files storing a type other than native FunctionType are converted
+ *  (and byte swapped if necessary) while loading. The converted volume
+ *  always holds FunctionType values, so a uint8 or uint16 file needs four
+ *  or two times its size in memory, and int32 or double values may be
+ *  rounded.
+ */
+class InputVolume
+{
+public:
+
+  //! Default constructor
+  InputVolume();
+
+  //! Destructor releasing the mapping or buffer
+  ~InputVolume();
+
+  //! Make the data of the given file available
+  /*! Open the given file and either map or read dim[0]*dim[1]*dim[2]
+   *  values of the given type.
+   * @param filename The name of the raw input file
+   * @param dim The dimensions of the volume
+   * @param type The type of the values stored in the file
+   * @param swap Whether the byte order of the file differs from the host
+   * @param use_mmap Whether to try memory mapping the file first
+   * @param layout The location of the values within the file
+   * @return 1 if successful 0 otherwise
+   */
+  int read(const char* filename, const GlobalIndexType dim[3], DataType type=DATA_FLOAT32,
+           bool swap=false, bool use_mmap=true, const InputLayout& layout=InputLayout());
+
+  //! Read only the box [low,high) of the volume
+  /*! Each contiguous row (or plane if the box spans the full width) of
+   *  the box is read with its own pread in parallel so the remainder of
+   *  the file is never touched. The resulting data is stored in x-fastest
+   *  order with dimensions high - low.
+   * @param filename The name of the raw input file
+   * @param dim The dimensions of the full volume
+   * @param low The first sample of the box in each dimension
+   * @param high One past the last sample of the box in each dimension
+   * @param type The type of the values stored in the file
+   * @param swap Whether the byte order of the file differs from the host
+   * @param layout The location of the values within the file
+   * @return 1 if successful 0 otherwise
+   */
+  int readRegion(const char* filename, const GlobalIndexType dim[3], const GlobalIndexType low[3],
+                 const GlobalIndexType high[3], DataType type=DATA_FLOAT32, bool swap=false,
+                 const InputLayout& layout=InputLayout());
+
+  //! Read the bricks of a bricked volume that may contain vertices above the threshold
+  /*! Only bricks whose index entry admits a vertex above the threshold
+   *  are read. All other bricks are set to their lowest value which
+   *  keeps the global minimum intact without touching the file.
+   * @param filename The name of the bricked volume
+   * @param greater The comparison defining the tree type
+   * @param threshold The threshold of the tree
+   * @param dim The dimensions of the volume read from the header
+   * @param index The brick index of the volume
+   * @param type DATA_UINT8 or DATA_UINT16 if the file stores these exactly
+   *             and DATA_FLOAT32 otherwise
+   * @return 1 if successful 0 otherwise
+   */
+  int readBricked(const char* filename, const Comparison& greater, FunctionType threshold,
+                  GlobalIndexType dim[3], BrickIndex& index, DataType& type);
+
+  //! Return a pointer to the data (only valid after a successful read)
+  const FunctionType* data() const {return mData;}
+
+  //! Return whether the data points into a memory mapping
+  bool mapped() const {return mMapping != NULL;}
+
+  //! Release the mapping and the buffer
+  void clear();
+
+private:
+
+  //! The pointer handed to the algorithms
+  const FunctionType* mData;
+
+  //! The start of the memory mapping if any
+  void* mMapping;
+
+  //! The size of the memory mapping in bytes
+  size_t mMappingSize;
+
+  //! The private buffer if the file was read rather than mapped
+  FunctionType* mBuffer;
+
+  //! The number of values the buffer can hold
+  /*! The buffer is kept across reads so reading a sequence of volumes
+   *  of the same size allocates only once.
+   */
+  size_t mCapacity;
+
+  //! Open the given file and check that it holds at least the given number of bytes
+  /*! @return The file descriptor or -1 in case of an error */
+  int openFile(const char* filename, size_t bytes, struct stat& info);
+
+  //! Try to map the given file descriptor
+  int map(int fd, size_t bytes);
+
+  //! Release the mapping only
+  void unmap();
+
+  //! Release the mapping but keep the buffer for the next read
+  void reset();
+
+  //! Return a buffer of at least the given number of values
+  FunctionType* allocate(size_t count);
+
+  //! Read and convert the given number of values from the file descriptor
+  /*! Seekable files are read in parallel using pread and everything
+   *  else sequentially.
+   */
+  int load(int fd, size_t count, DataType type, bool swap, bool seekable,
+           const InputLayout& layout);
+};
+
+
+#endif /* INPUTVOLUME_H_ */
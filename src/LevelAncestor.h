@@ -0,0 +1,122 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#ifndef LEVELANCESTOR_H
+#define LEVELANCESTOR_H
+
+#include <vector>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "MergeTree.h"
+
+//! Binary lifting index over the descendants of a merge tree
+/*! For every node the index stores its 2^k'th descendant for all k so
+ *  that walking down the tree, e.g. to find the feature containing a
+ *  vertex at a given threshold, takes O(log n) rather than O(depth)
+ *  steps. The levels are built in parallel, one pass per level.
+ */
+class LevelAncestor
+{
+public:
+
+  //! Default constructor
+  LevelAncestor() : mGreater(NULL) {}
+
+  //! Destructor
+  ~LevelAncestor() {}
+
+  //! Build the index for the given tree
+  /*!
+   * @param tree The merge tree
+   * @param data The function values
+   * @param greater The comparison defining the tree type
+   * @return 1 if successful 0 otherwise
+   */
+  int build(const MergeTree& tree, const FunctionType* data, const Comparison& greater);
+
+  //! Return whether the index is empty
+  bool empty() const {return mJump.empty();}
+
+  //! Return the k'th descendant of node n or LNULL
+  LocalIndexType ancestor(LocalIndexType n, LocalIndexType k) const;
+
+  //! Return the lowest node of the feature containing node n at the given threshold
+  /*! This is the lowest descendant of n (including n) still above the
+   *  threshold or LNULL if n itself lies below it
+   */
+  LocalIndexType feature(LocalIndexType n, FunctionType threshold) const;
+
+private:
+
+  //! The comparison defining the tree type
+  const Comparison* mGreater;
+
+  //! The function value of each node
+  std::vector<FunctionType> mValue;
+
+  //! mJump[k][i] is the 2^k'th descendant of node i or LNULL
+  std::vector<std::vector<LocalIndexType> > mJump;
+};
+
+
+#endif /* LEVELANCESTOR_H_ */
@@ -78,6 +78,15 @@ public:
   //! Destructor
   virtual ~LocalThreshold() {}
 
+  //! The distance to the local maximum is at most the height of the tree
+  virtual void range(FunctionType& low, FunctionType& high) const {
+    low = 0;
+    high = fabs(mTree->maximum() - mTree->minimum());
+  }
+
+  //! The distance to the local maximum grows towards the roots
+  virtual bool descending(const Comparison& /*greater*/) const {return false;}
+
   //! Evaluate the metric at vertex id with the given label
   virtual FunctionType eval(GlobalIndexType id, LocalIndexType label) const;
 
@@ -65,70 +65,405 @@
 #include <algorithm>
 #include <set>
 #include <cmath>
+#include <chrono>
+#include <limits>
+#include <functional>
+#include <iterator>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "MTAlgorithm.h"
 
-extern FunctionType* gData;
+// The data and its dimensions are thread local so that several threads can
+// each process their own volume at the same time. OpenMP workers do not
+// inherit them, so every parallel region must read them through locals
+// set before the pragma
+extern thread_local const FunctionType* gData;
+
+extern thread_local GlobalIndexType gDim[3];
+
+/*!
+ * Sort the given vertices by their integer function values using a
+ * parallel counting sort. Each thread histograms a contiguous block of
+ * the input and the per-thread prefix sums are interleaved by bucket so
+ * that the scatter is stable. Since the screening produces the vertices
+ * in ascending index order, ties are thus broken by index exactly as the
+ * simulation of simplicity requires.
+ * @param order The vertices to sort in ascending index order
+ * @param data The function values which must be integers in [0,domain)
+ * @param domain The number of possible values
+ * @param descending Whether to sort from high to low values
+ */
+static void counting_sort(std::vector<GlobalIndexType>& order, const FunctionType* data,
+                          uint32_t domain, bool descending)
+{
+  int thread_count = 1;
+#ifdef _OPENMP
+  thread_count = omp_get_max_threads();
+#endif
+
+  GlobalIndexType n = order.size();
+  std::vector<GlobalIndexType> sorted(n);
+  std::vector<std::vector<GlobalIndexType> > offsets(thread_count);
+
+#pragma omp parallel num_threads(thread_count)
+  {
+    int t = 0;
+    int threads = 1;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+    threads = omp_get_num_threads();
+#endif
+    GlobalIndexType begin = n*t / threads;
+    GlobalIndexType end = n*(t+1) / threads;
+    std::vector<GlobalIndexType>& histogram = offsets[t];
+
+    histogram.assign(domain,0);
+    for (GlobalIndexType i=begin;i<end;i++)
+      histogram[(uint32_t)data[order[i]]]++;
+
+#pragma omp barrier
+#pragma omp single
+    {
+      // Turn the histograms into starting offsets. For each bucket (in
+      // sort order) the blocks of the threads follow in thread order
+      GlobalIndexType sum = 0;
+      GlobalIndexType count;
+
+      for (uint32_t k=0;k<domain;k++) {
+        uint32_t b = descending ? domain - 1 - k : k;
+
+        for (int i=0;i<threads;i++) {
+          count = offsets[i][b];
+          offsets[i][b] = sum;
+          sum += count;
+        }
+      }
+    }
+
+    for (GlobalIndexType i=begin;i<end;i++)
+      sorted[histogram[(uint32_t)data[order[i]]]++] = order[i];
+  }
+
+  order.swap(sorted);
+}
+
+//! The number of vertices of the hint per bucket of the warm start
+static const GlobalIndexType gBucketSize = 64;
+
+//! A vertex and its key of the warm started sort
+/*! The key is the function value for merge trees and its negation for
+ *  split trees, so vertices are always sorted by descending key with
+ *  ties broken by index. Carrying the key avoids looking up the values
+ *  in random order during the sort.
+ */
+class SortKey
+{
+public:
+
+  //! The key
+  FunctionType mKey;
+
+  //! The vertex
+  GlobalIndexType mIndex;
+
+  //! Return whether this vertex comes before the given one
+  bool operator<(const SortKey& k) const {
+    return (mKey > k.mKey) || ((mKey == k.mKey) && (mIndex < k.mIndex));
+  }
+};
+
+/*!
+ * Sort the given vertices using the sorted order of a similar function
+ * as a hint. Every gBucketSize'th vertex of the hint that is still above
+ * the threshold becomes a splitter. The splitters are sorted by their
+ * current values and every vertex is assigned to the bucket between two
+ * splitters by a galloping search starting from the bucket of its
+ * previous rank, which takes O(log d) for a vertex that moved by d
+ * buckets. Vertices new above the threshold are placed by binary search.
+ * The buckets are then sorted independently in parallel, so for slowly
+ * evolving data the sort takes O(n log gBucketSize). Since the
+ * comparison is a total order the result is identical to that of any
+ * other sort.
+ * @param order The vertices to sort
+ * @param hint The previous order
+ * @param label The labels of all vertices which must be LNULL and are restored
+ * @param greater The comparison defining the tree type
+ * @param threshold The threshold of the tree
+ * @return 1 if the hint was used and 0 if it is too small in which case
+ *         order is unchanged
+ */
+static int hinted_sort(std::vector<GlobalIndexType>& order, const std::vector<GlobalIndexType>& hint,
+                       LocalIndexType* label, const Comparison& greater, FunctionType threshold)
+{
+  GlobalIndexType count = gDim[0]*gDim[1]*gDim[2];
+  FunctionType sign = greater(1,0) ? 1 : -1;
+  std::vector<SortKey> items;
+  std::vector<SortKey> splitters;
+  SortKey item;
+
+  items.reserve(order.size());
+
+  // Keep the vertices of the hint that are still above the threshold in
+  // their previous order and temporarily mark them in the labels
+  for (std::vector<GlobalIndexType>::const_iterator it=hint.begin();it!=hint.end();it++) {
+    if ((*it < count) && greater(gData[*it],threshold)) {
+      item.mKey = sign*gData[*it];
+      item.mIndex = *it;
+
+      if ((items.size() % gBucketSize) == gBucketSize - 1)
+        splitters.push_back(item);
+
+      items.push_back(item);
+      label[*it] = 0;
+    }
+  }
+
+  // Too few vertices remain for a single splitter so remove the marks
+  // again and leave the order to the generic sort
+  if (splitters.empty()) {
+    for (std::vector<SortKey>::const_iterator it=items.begin();it!=items.end();it++)
+      label[it->mIndex] = LNULL;
+    return 0;
+  }
+
+  GlobalIndexType kept = items.size();
+
+  // Append the vertices that have risen above the threshold and clear
+  // the marks
+  for (std::vector<GlobalIndexType>::iterator it=order.begin();it!=order.end();it++) {
+    if (label[*it] == LNULL) {
+      item.mKey = sign*gData[*it];
+      item.mIndex = *it;
+      items.push_back(item);
+    }
+    else
+      label[*it] = LNULL;
+  }
+
+  std::sort(splitters.begin(),splitters.end());
+
+  // The bucket of a vertex is the number of splitters preceding it
+  GlobalIndexType m = splitters.size();
+  std::vector<uint32_t> bucket(items.size());
+  GlobalIndexType moved = 0;
+
+#pragma omp parallel for schedule(static) reduction(+:moved)
+  for (int64_t i=0;i<(int64_t)items.size();i++) {
+    const SortKey& v = items[i];
+    GlobalIndexType guess = std::min((GlobalIndexType)i / gBucketSize,m);
+    GlobalIndexType low,high,step = 1;
+
+    // Bracket the bucket in [low,high] by doubling steps away from the
+    // guess and finish with a binary search
+    if ((GlobalIndexType)i >= kept) {
+      low = 0;
+      high = m;
+    }
+    else if ((guess < m) && (splitters[guess] < v)) {
+      low = guess + 1;
+      high = std::min(low + step,m);
+      while ((high < m) && (splitters[high] < v)) {
+        low = high + 1;
+        step *= 2;
+        high = std::min(low + step,m);
+      }
+    }
+    else {
+      high = guess;
+      low = (high > step) ? high - step : 0;
+      while ((low > 0) && !(splitters[low-1] < v)) {
+        high = low - 1;
+        step *= 2;
+        low = (high > step) ? high - step : 0;
+      }
+    }
+
+    GlobalIndexType b = std::lower_bound(splitters.begin() + low,splitters.begin() + high,v)
+                        - splitters.begin();
+
+    if ((GlobalIndexType)i < kept)
+      moved += (b > guess) ? b - guess : guess - b;
+
+    bucket[i] = (uint32_t)b;
+  }
+
+  fprintf(stderr,"Warm start kept %llu of %zu vertices which moved by %.1f buckets on average\n",
+          (unsigned long long)kept,items.size(),moved / (double)kept);
 
-extern GlobalIndexType gDim[3];
+  // Scatter the vertices into their buckets
+  std::vector<GlobalIndexType> offsets(m + 3,0);
+  std::vector<SortKey> sorted(items.size());
 
+  for (GlobalIndexType i=0;i<items.size();i++)
+    offsets[bucket[i] + 2]++;
+  for (GlobalIndexType b=2;b<m+3;b++)
+    offsets[b] += offsets[b-1];
+  for (GlobalIndexType i=0;i<items.size();i++)
+    sorted[offsets[bucket[i] + 1]++] = items[i];
+
+  // Now offsets[b] is the start of the b'th bucket
+#pragma omp parallel for schedule(dynamic,16)
+  for (int64_t b=0;b<=(int64_t)m;b++) {
+    std::sort(sorted.begin() + offsets[b],sorted.begin() + offsets[b+1]);
+
+    for (GlobalIndexType i=offsets[b];i<offsets[b+1];i++)
+      order[i] = sorted[i].mIndex;
+  }
+
+  return 1;
+}
 
 int merge_tree_sorted_sweep(Comparison& greater,
                             Neighborhood& neighborhood,
                             const FunctionType threshold,
                             MergeTree &tree, bool augmented,
-                            LocalIndexType* label)
+                            LocalIndexType* label,
+                            const SweepOptions& options)
 {
   std::vector<GlobalIndexType> order;
-  std::vector<GlobalIndexType>::iterator oIt;
+  FunctionType low;
 
+  // Reuse the storage of a previous sweep if possible
+  if (options.mOrder != NULL)
+    order.swap(*options.mOrder);
+
+  sort_vertices(greater,threshold,label,options,order,low);
+
+  sweep_sorted_vertices(neighborhood,order,low,tree,augmented,label);
+
+  if (options.mOrder != NULL)
+    options.mOrder->swap(order);
+
+  return 1;
+}
+
+int sort_vertices(Comparison& greater, const FunctionType threshold, LocalIndexType* label,
+                  const SweepOptions& options, std::vector<GlobalIndexType>& order,
+                  FunctionType& low)
+{
   GlobalIndexType i;
   GlobalIndexType count = gDim[0]*gDim[1]*gDim[2];
-  FunctionType low = gData[0];
+
+  low = gData[0];
+  order.clear();
+
+  if (options.mReserve > 0)
+    order.reserve(options.mReserve);
 
 
   fprintf(stderr,"Screening vertices\n");
 
-  // First we collect all vertex indices above the threshold,
-  // initialize the labels volume and keep track of the global
-  // minimum
-  for (i=0;i<count;i++) {
-    label[i] = LNULL;
-    if (greater(gData[i],threshold))
-      order.push_back(i);
+  if (options.mBricks != NULL) {
+    const BrickIndex& bricks = *options.mBricks;
+    const uint32_t* counts = bricks.counts();
+    uint32_t size = bricks.brickSize();
+    std::vector<char> active;
+    uint32_t screened = bricks.activeBricks(greater,threshold,active);
 
-    if (greater(low,gData[i]))
-      low = gData[i];
-    //if (data[i] != 0)
-    //  fprintf(stderr,"%f\n",data[i]);
+    // The global minimum follows from the index
+    low = bricks.lowest(greater);
+
+    fprintf(stderr,"Screening %u of %u bricks\n",screened,bricks.brickCount());
+
+    // Collect the vertices of all active bricks row by row so that the
+    // order remains ascending by index. Rows of rejected bricks only
+    // need their labels initialized
+    for (GlobalIndexType z=0;z<gDim[2];z++) {
+      for (GlobalIndexType y=0;y<gDim[1];y++) {
+        GlobalIndexType row = (z*gDim[1] + y)*gDim[0];
+
+        for (uint32_t bx=0;bx<counts[0];bx++) {
+          GlobalIndexType first = row + bx*size;
+          GlobalIndexType last = row + std::min((GlobalIndexType)(bx+1)*size,gDim[0]);
+
+          if (!active[bricks.brick(bx,y / size,z / size)]) {
+            std::fill(label + first,label + last,LNULL);
+            continue;
+          }
+
+          for (i=first;i<last;i++) {
+            label[i] = LNULL;
+            if (greater(gData[i],threshold))
+              order.push_back(i);
+          }
+        }
+      }
+    }
+  }
+  else {
+    // First we collect all vertex indices above the threshold,
+    // initialize the labels volume and keep track of the global
+    // minimum
+    for (i=0;i<count;i++) {
+      label[i] = LNULL;
+      if (greater(gData[i],threshold))
+        order.push_back(i);
+
+      if (greater(low,gData[i]))
+        low = gData[i];
+      //if (data[i] != 0)
+      //  fprintf(stderr,"%f\n",data[i]);
+    }
   }
 
-  fprintf(stderr,"Sorting %d vertices\n", order.size());
+  // Integer data with a small domain can be sorted in linear time
+  bool counting = (options.mDomain > 0) && (options.mSort != SORT_GENERIC);
+  if ((options.mSort == SORT_COUNTING) && !counting)
+    fprintf(stderr,"Counting sort needs 8 or 16 bit input, using the generic sort instead\n");
 
-  // Sort all the vertices above the threshold by descending order.
-  IndexComp sort_comp(gData,greater);
-  std::sort(order.begin(),order.end(),sort_comp);
+  fprintf(stderr,"Sorting %zu vertices\n", order.size());
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-  tree.maximum(gData[order[0]]);
-  tree.minimum(low);
+  // Counting sort is linear already so the hint is only used otherwise
+  bool warm = !counting && (options.mHint != NULL) && !options.mHint->empty()
+              && (hinted_sort(order,*options.mHint,label,greater,threshold) == 1);
+
+  if (counting) {
+    counting_sort(order,gData,options.mDomain,greater(1,0));
+  }
+  else if (!warm) {
+    // Sort all the vertices above the threshold by descending order.
+    IndexComp sort_comp(gData,greater);
+    std::sort(order.begin(),order.end(),sort_comp);
+  }
+
+  fprintf(stderr,"Sorting took %.3f s (%s)\n",
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+          counting ? "counting" : (warm ? "warm start" : "generic"));
+
+  return 1;
+}
+
+/*!
+ * Continue a sweep with the vertices of the given order starting at
+ * begin. The tree, labels and union-find structure must be in the state
+ * the sweep has left them after processing all previous vertices.
+ */
+static void sweep_range(Neighborhood& neighborhood, const std::vector<GlobalIndexType>& order,
+                        GlobalIndexType begin, MergeTree& tree, bool augmented,
+                        LocalIndexType* label, UnionFind& uf)
+{
+  std::vector<GlobalIndexType>::const_iterator oIt;
 
   // Get a neighborhood iterator
   Neighborhood::iterator it;
 
-  // Create a local union find of labels
-  UnionFind uf;
   LocalIndexType neigh_label;
   LocalIndexType new_label;
 
   // Setup some progress report
-  uint32_t progress = 0;
+  GlobalIndexType progress = 0;
+  GlobalIndexType total = order.size() - begin;
   uint32_t next = 1;
   fprintf(stderr,"Processing  %03d%%\r",0);
 
-  // For all vertices in descending order
-  for (oIt=order.begin();oIt!=order.end();oIt++) {
-    if (100*progress/order.size() >= next) {
-      fprintf(stderr,"Processing  %03zu%%\r",100*progress/order.size());
+  // For all remaining vertices in descending order
+  for (oIt=order.begin()+begin;oIt!=order.end();oIt++) {
+    if (100*progress/total >= next) {
+      fprintf(stderr,"Processing  %03zu%%\r",(size_t)(100*progress/total));
       next++;
     }
     progress++;
@@ -211,9 +546,366 @@ int merge_tree_sorted_sweep(Comparison& greater,
 
 
   fprintf(stderr,"Processing  100%% \n");
+}
+
+int sweep_sorted_vertices(Neighborhood& neighborhood, const std::vector<GlobalIndexType>& order,
+                          FunctionType low, MergeTree& tree, bool augmented, LocalIndexType* label,
+                          UnionFind* labels)
+{
+  if (order.empty()) {
+    fprintf(stderr,"No vertices above the threshold\n");
+    tree.minimum(low);
+    tree.maximum(low);
+    return 1;
+  }
+
+  tree.maximum(gData[order[0]]);
+  tree.minimum(low);
+
+  // Create a local union find of labels or reuse the given one
+  UnionFind local_uf;
+  UnionFind& uf = (labels != NULL) ? *labels : local_uf;
+
+  uf.clear();
+
+  sweep_range(neighborhood,order,0,tree,augmented,label,uf);
 
   return 1;
 }
 
+//! Return whether vertex v lies in the box [low,high)
+static bool inside_box(GlobalIndexType v, const GlobalIndexType low[3], const GlobalIndexType high[3])
+{
+  GlobalIndexType x = v % gDim[0];
+  GlobalIndexType y = (v / gDim[0]) % gDim[1];
+  GlobalIndexType z = v / (gDim[0]*gDim[1]);
 
+  return (x >= low[0]) && (x < high[0]) && (y >= low[1]) && (y < high[1])
+      && (z >= low[2]) && (z < high[2]);
+}
 
+int merge_tree_update(Comparison& greater, Neighborhood& neighborhood,
+                      const FunctionType threshold, const GlobalIndexType low[3],
+                      const GlobalIndexType high[3], const FunctionType* previous,
+                      MergeTree& tree, bool augmented, LocalIndexType* label,
+                      std::vector<GlobalIndexType>& order, UnionFind* labels)
+{
+  GlobalIndexType i,x,y,z,v;
+  GlobalIndexType count = gDim[0]*gDim[1]*gDim[2];
+  IndexComp sort_comp(gData,greater);
+
+  for (i=0;i<3;i++) {
+    if (high[i] > gDim[i]) {
+      fprintf(stderr,"Error, the changed box exceeds the dimensions of the volume\n");
+      return 0;
+    }
+
+    // Nothing has changed
+    if (low[i] >= high[i])
+      return 1;
+  }
+
+  // Collect the vertices of the box that lie above the threshold now
+  // together with the highest one before the change and the lowest values
+  // before and after it
+  std::vector<GlobalIndexType> fresh;
+  GlobalIndexType top = GNULL;
+  FunctionType top_value = 0;
+  FunctionType old_low = previous[0];
+  FunctionType new_low = gData[(low[2]*gDim[1] + low[1])*gDim[0] + low[0]];
+  const FunctionType* old_value = previous;
+
+  for (z=low[2];z<high[2];z++) {
+    for (y=low[1];y<high[1];y++) {
+      for (x=low[0];x<high[0];x++,old_value++) {
+        v = (z*gDim[1] + y)*gDim[0] + x;
+        if (greater(gData[v],threshold))
+          fresh.push_back(v);
+
+        // Ties are ordered by index so the first of equal values stays the highest
+        if (greater(*old_value,threshold) && ((top == GNULL) || greater(*old_value,top_value))) {
+          top = v;
+          top_value = *old_value;
+        }
+
+        if (greater(old_low,*old_value))
+          old_low = *old_value;
+        if (greater(new_low,gData[v]))
+          new_low = gData[v];
+      }
+    }
+  }
+  std::sort(fresh.begin(),fresh.end(),sort_comp);
+
+  // All vertices before the first one of the box have kept their values
+  // and thus their relative order. These are the vertices outside the box
+  // that came before its highest previous vertex which, since the order
+  // is sorted by the previous values, is found by a binary search
+  GlobalIndexType first = order.size();
+  if (top != GNULL) {
+    GlobalIndexType lower = 0;
+    GlobalIndexType upper = order.size();
+    GlobalIndexType middle;
+
+    while (lower < upper) {
+      middle = lower + (upper - lower) / 2;
+      v = order[middle];
+
+      if (!inside_box(v,low,high) && (greater(gData[v],top_value)
+                                      || ((gData[v] == top_value) && (v < top))))
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+    first = lower;
+  }
+
+  // so the new order starts to differ at the earlier of that vertex and
+  // the position of the highest vertex of the box
+  GlobalIndexType start = first;
+  if (!fresh.empty())
+    start = std::lower_bound(order.begin(),order.begin() + first,fresh[0],sort_comp) - order.begin();
+
+  // Merge the box back into the remainder of the order
+  std::vector<GlobalIndexType> tail(order.begin() + start,order.end());
+  std::vector<GlobalIndexType> kept;
+
+  kept.reserve(tail.size());
+  for (i=0;i<tail.size();i++) {
+    if (!inside_box(tail[i],low,high))
+      kept.push_back(tail[i]);
+  }
+
+  order.resize(start);
+  order.reserve(start + kept.size() + fresh.size());
+  std::merge(kept.begin(),kept.end(),fresh.begin(),fresh.end(),std::back_inserter(order),sort_comp);
+
+  // The sweep of the common prefix is unaffected by the change since it
+  // only depends on the order and the connectivity of the vertices
+  GlobalIndexType prefix = start;
+  while ((prefix < order.size()) && (prefix - start < tail.size()) && (order[prefix] == tail[prefix - start]))
+    prefix++;
+
+  // Undo the remainder of the previous sweep remembering which arcs it
+  // has extended
+  std::vector<LocalIndexType> touched;
+  for (i=prefix - start;i<tail.size();i++) {
+    v = tail[i];
+    if (augmented && (label[v] != LNULL) && (tree.node(label[v]).index() != v))
+      touched.push_back(label[v]);
+    label[v] = LNULL;
+  }
+
+  // The nodes are created in sorted order and labeled by themselves, so
+  // the nodes of the prefix are exactly those whose vertex kept its label
+  LocalIndexType lower = 0;
+  LocalIndexType upper = tree.size();
+  LocalIndexType middle;
+
+  while (lower < upper) {
+    middle = lower + (upper - lower) / 2;
+    if (label[tree.node(middle).index()] != LNULL)
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+
+  // Arcs are extended in sorted order so the undone vertices are at their end
+  tree.clearFeatureIndex();
+  for (i=0;i<touched.size();i++) {
+    if (touched[i] >= lower)
+      continue;
+
+    std::vector<GlobalIndexType>& vertices = tree.arc(touched[i]).mVertices;
+    while (label[vertices.back()] == LNULL)
+      vertices.pop_back();
+  }
+
+  tree.truncate(lower);
+
+  // The union-find of the prefix links every node to its descendant
+  UnionFind local_uf;
+  UnionFind& uf = (labels != NULL) ? *labels : local_uf;
+
+  uf.clear();
+  for (LocalIndexType n=0;n<tree.size();n++)
+    uf.addLabel(n);
+  for (LocalIndexType n=0;n<tree.size();n++) {
+    if (tree.node(n).down() != LNULL)
+      uf.mergeLabel(n,tree.node(n).down());
+  }
+
+  // The minimum only changes with the box unless the box contained it and
+  // has been raised in which case the whole volume is scanned once more
+  FunctionType lowest = tree.minimum();
+
+  if (greater(old_low,lowest))
+    lowest = greater(lowest,new_low) ? new_low : lowest;
+  else if (!greater(new_low,old_low))
+    lowest = new_low;
+  else {
+    const FunctionType sign = greater(1,0) ? 1 : -1;
+    const FunctionType* data = gData;
+
+    lowest = sign*data[0];
+#pragma omp parallel for schedule(static) reduction(min:lowest)
+    for (int64_t k=0;k<(int64_t)count;k++)
+      lowest = std::min(lowest,sign*data[k]);
+    lowest *= sign;
+  }
+
+  tree.minimum(lowest);
+  tree.maximum(order.empty() ? lowest : gData[order[0]]);
+
+  fprintf(stderr,"Re-sweeping %llu of %llu vertices\n",(unsigned long long)(order.size() - prefix),
+          (unsigned long long)order.size());
+
+  sweep_range(neighborhood,order,prefix,tree,augmented,label,uf);
+
+  return 1;
+}
+
+FunctionType quantile_threshold(const FunctionType* data, GlobalIndexType count,
+                                const Comparison& greater, double quantile, GlobalIndexType& above)
+{
+  // Work with keys that increase towards the kept vertices so that the
+  // cutoff is the k'th largest key
+  const FunctionType sign = greater(1,0) ? 1 : -1;
+  const uint32_t bins = 4096;
+  GlobalIndexType k = (GlobalIndexType)(std::min(std::max(quantile,0.0),1.0)*count);
+  FunctionType low = sign*data[0];
+  FunctionType high = sign*data[0];
+
+#pragma omp parallel for schedule(static) reduction(min:low) reduction(max:high)
+  for (int64_t i=0;i<(int64_t)count;i++) {
+    low = std::min(low,sign*data[i]);
+    high = std::max(high,sign*data[i]);
+  }
+
+  if (k == 0) {
+    above = 0;
+    return sign*high;
+  }
+
+  if ((k >= count) || (low == high)) {
+    above = (k >= count) ? count : 0;
+    return (k >= count) ? sign*std::nextafter(low,-std::numeric_limits<FunctionType>::max()) : sign*high;
+  }
+
+  int thread_count = 1;
+#ifdef _OPENMP
+  thread_count = omp_get_max_threads();
+#endif
+
+  const double scale = bins / ((double)high - low);
+  std::vector<std::vector<GlobalIndexType> > local(thread_count);
+
+  // Histogram the keys in parallel
+#pragma omp parallel num_threads(thread_count)
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    std::vector<GlobalIndexType>& histogram = local[t];
+    histogram.assign(bins,0);
+
+#pragma omp for schedule(static)
+    for (int64_t i=0;i<(int64_t)count;i++)
+      histogram[std::min((uint32_t)((sign*data[i] - low)*scale),bins - 1)]++;
+  }
+
+  // Find the bin containing the k'th largest key counting from the top
+  GlobalIndexType higher = 0;
+  GlobalIndexType size = 0;
+  uint32_t bin = bins;
+
+  while (bin-- > 0) {
+    size = 0;
+    for (int t=0;t<thread_count;t++)
+      size += local[t][bin];
+
+    if (higher + size > k)
+      break;
+    higher += size;
+  }
+
+  // Collect the keys of that bin and select the cutoff among them
+  std::vector<std::vector<FunctionType> > selected(thread_count);
+  std::vector<FunctionType> candidates;
+
+#pragma omp parallel num_threads(thread_count)
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    selected[t].reserve(local[t][bin]);
+
+#pragma omp for schedule(static)
+    for (int64_t i=0;i<(int64_t)count;i++) {
+      if (std::min((uint32_t)((sign*data[i] - low)*scale),bins - 1) == bin)
+        selected[t].push_back(sign*data[i]);
+    }
+  }
+
+  candidates.reserve(size);
+  for (int t=0;t<thread_count;t++)
+    candidates.insert(candidates.end(),selected[t].begin(),selected[t].end());
+
+  std::vector<FunctionType>::iterator cutoff = candidates.begin() + (k - higher);
+  std::nth_element(candidates.begin(),cutoff,candidates.end(),std::greater<FunctionType>());
+
+  FunctionType threshold = *cutoff;
+
+  above = higher;
+  for (std::vector<FunctionType>::iterator it=candidates.begin();it!=cutoff;it++) {
+    if (*it > threshold)
+      above++;
+  }
+
+  return sign*threshold;
+}
+
+void count_labels(const LocalIndexType* label, GlobalIndexType count, LocalIndexType labels,
+                  std::vector<GlobalIndexType>& sizes)
+{
+  int thread_count = 1;
+#ifdef _OPENMP
+  thread_count = omp_get_max_threads();
+#endif
+
+  std::vector<std::vector<GlobalIndexType> > local(thread_count);
+
+#pragma omp parallel num_threads(thread_count)
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    std::vector<GlobalIndexType>& histogram = local[t];
+    histogram.assign(labels,0);
+
+#pragma omp for schedule(static)
+    for (int64_t i=0;i<(int64_t)count;i++) {
+      if (label[i] != LNULL)
+        histogram[label[i]]++;
+    }
+  }
+
+  sizes.assign(labels,0);
+  for (int t=0;t<thread_count;t++) {
+    for (LocalIndexType l=0;l<local[t].size();l++)
+      sizes[l] += local[t][l];
+  }
+}
+
+void relabel_vertices(LocalIndexType* label, GlobalIndexType count,
+                      const std::vector<LocalIndexType>& map)
+{
+#pragma omp parallel for schedule(static)
+  for (int64_t i=0;i<(int64_t)count;i++) {
+    if (label[i] != LNULL)
+      label[i] = map[label[i]];
+  }
+}
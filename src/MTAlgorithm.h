@@ -69,12 +69,149 @@
 #include "Neighborhood.h"
 #include "UnionFind.h"
 #include "MergeTree.h"
+#include "BrickIndex.h"
+
+//! Enum of the available sorting algorithms
+enum SortType {
+  SORT_AUTO = 0,
+  SORT_GENERIC = 1,
+  SORT_COUNTING = 2,
+};
+
+//! Optional information used to accelerate the sorted sweep
+class SweepOptions
+{
+public:
+
+  //! Default constructor
+  SweepOptions() : mDomain(0), mSort(SORT_AUTO), mBricks(NULL), mOrder(NULL), mReserve(0), mHint(NULL) {}
+
+  //! The number of distinct integer values [0,mDomain) of the data or 0
+  /*! If the data is known to consist of small non-negative integers (e.g.
+   *  because it has been read from an 8 or 16 bit type) the vertices can
+   *  be ordered with a counting sort
+   */
+  uint32_t mDomain;
+
+  //! Which sort to use. SORT_AUTO picks counting sort whenever mDomain allows it
+  SortType mSort;
+
+  //! An optional brick index of the data
+  /*! If given, bricks that cannot contain a vertex above the threshold
+   *  are never screened, their labels are initialized in bulk and the
+   *  global minimum is taken from the index
+   */
+  const BrickIndex* mBricks;
+
+  //! If given, the sorted order of the vertices above the threshold is returned
+  /*! The sweep processes the vertices strictly in this order, so the
+   *  tree and labels of any higher threshold are those of its prefix.
+   *  The storage previously held by the vector is reused.
+   */
+  std::vector<GlobalIndexType>* mOrder;
+
+  //! The number of vertices above the threshold if known in advance or 0
+  GlobalIndexType mReserve;
+
+  //! The sorted order of a similar volume of the same dimensions or NULL
+  /*! For consecutive timesteps of a simulation the order of the previous
+   *  step is nearly sorted for the current one. Every 64th vertex of the
+   *  hint still above the threshold then splits the order into buckets,
+   *  each vertex is placed into its bucket by a galloping search from its
+   *  previous rank and only the small buckets are sorted. The result is
+   *  identical to a full sort however much the order has changed, only
+   *  the speed depends on it. The hint is ignored if a counting sort is
+   *  used or fewer than 64 of its vertices remain above the threshold.
+   *  It must not be the vector passed as mOrder.
+   */
+  const std::vector<GlobalIndexType>* mHint;
+};
 
 int merge_tree_sorted_sweep(Comparison& greater,
                             Neighborhood& neighborhood,
                             const FunctionType threshold,
                             MergeTree &tree, bool augmented,
-                            LocalIndexType* label);
+                            LocalIndexType* label,
+                            const SweepOptions& options=SweepOptions());
+
+//! Collect all vertices above the threshold in descending order
+/*! This is the first phase of merge_tree_sorted_sweep. All labels are
+ *  initialized to LNULL.
+ * @param greater The comparison defining the tree type
+ * @param threshold The threshold of the tree
+ * @param label The labels of all vertices
+ * @param options Options accelerating the screening and sort (mOrder is ignored)
+ * @param order Returns the sorted vertices, reusing its storage
+ * @param low Returns the global minimum of the data
+ * @return 1 if successful 0 otherwise
+ */
+int sort_vertices(Comparison& greater, const FunctionType threshold, LocalIndexType* label,
+                  const SweepOptions& options, std::vector<GlobalIndexType>& order,
+                  FunctionType& low);
+
+//! Compute the tree and labels from the sorted vertices
+/*! This is the second phase of merge_tree_sorted_sweep and expects the
+ *  labels as left by sort_vertices. Passing the union-find structure
+ *  (and a cleared tree) of a previous sweep reuses their storage.
+ * @return 1 if successful 0 otherwise
+ */
+int sweep_sorted_vertices(Neighborhood& neighborhood, const std::vector<GlobalIndexType>& order,
+                          FunctionType low, MergeTree& tree, bool augmented, LocalIndexType* label,
+                          UnionFind* labels=NULL);
+
+//! Update the tree and labels of a sorted sweep after the data of a box has changed
+/*! The vertices outside the box keep their relative order, so the new
+ *  order is obtained by merging the re-sorted vertices of the box into
+ *  the previous one. The node ids of a sweep depend on the global order,
+ *  so the sweep of the common prefix of both orders is kept while the
+ *  tree, labels and union-find structure are cut back to it and the
+ *  remaining vertices are swept again. The result is identical to a new
+ *  sweep of the changed data. Changes to low function values thus only
+ *  re-sweep the few vertices below them while changes near the maximum
+ *  amount to a full sweep without the sort. Apart from the re-sweep the
+ *  update touches only the box, the tail of the order behind the change
+ *  and O(log n) entries of its head. Only raising the global minimum
+ *  requires a scan of the whole volume.
+ * @param greater The comparison defining the tree type
+ * @param neighborhood The neighborhood of the vertices
+ * @param threshold The threshold of the previous sweep
+ * @param low The first changed sample in each dimension
+ * @param high One past the last changed sample in each dimension
+ * @param previous The values of the box before the change (x fastest)
+ * @param tree The unsimplified tree of the previous sweep
+ * @param augmented Whether the arcs contain all vertices
+ * @param label The labels of the previous sweep
+ * @param order The sorted order of the previous sweep (see SweepOptions::mOrder)
+ * @param labels Optionally the union-find structure to reuse
+ * @return 1 if successful 0 otherwise
+ */
+int merge_tree_update(Comparison& greater, Neighborhood& neighborhood,
+                      const FunctionType threshold, const GlobalIndexType low[3],
+                      const GlobalIndexType high[3], const FunctionType* previous,
+                      MergeTree& tree, bool augmented, LocalIndexType* label,
+                      std::vector<GlobalIndexType>& order, UnionFind* labels=NULL);
+
+//! Find the threshold above which the given fraction of the vertices lies
+/*! The cutoff is found in linear time using a parallel histogram of the
+ *  values followed by a selection among the values of the bin that
+ *  contains it. Ties at the cutoff are excluded.
+ * @param data The function values
+ * @param count The number of values
+ * @param greater The comparison defining the tree type
+ * @param quantile The fraction of the vertices to keep in [0,1]
+ * @param above Returns the number of vertices above the threshold
+ * @return The threshold
+ */
+FunctionType quantile_threshold(const FunctionType* data, GlobalIndexType count,
+                                const Comparison& greater, double quantile, GlobalIndexType& above);
+
+//! Count the vertices of each of the given number of labels
+void count_labels(const LocalIndexType* label, GlobalIndexType count, LocalIndexType labels,
+                  std::vector<GlobalIndexType>& sizes);
+
+//! Replace every label l != LNULL by map[l]
+void relabel_vertices(LocalIndexType* label, GlobalIndexType count,
+                      const std::vector<LocalIndexType>& map);
 
 
 
@@ -67,12 +67,47 @@ void print_help(FILE* output, const char* exec)
 {
   fprintf(output,"Usage: %s [options]\nWhere options can be any of the following:\n\n",exec);
 
-  fprintf(output,"--i <filename>\n\tFilename of the input file\n");
+  fprintf(output,"--i <filename>\n\tFilename of the input file. Bricked volumes (see brick_volume) are recognized\n\
+      \tautomatically and only bricks that may contain vertices above the threshold are read\n");
   fprintf(output,"--o <filename>\n\tFilename of the output file if not provided stdout will be used\n");
+  fprintf(output,"--direct-io\n\tWrite the output with O_DIRECT bypassing the page cache if supported\n");
+  fprintf(output,"--format <string>\n\
+      \t    raw: Headerless volume of floats (or quantized values) (default)\n\
+      \tbricked: Self-describing volume of bricks with a header (dims, type, metric, tree type, threshold)\n\
+      \t         and an index of the minimal and maximal value of each brick\n\
+      \t sparse: Header followed by runs of consecutive feature voxels (uint64 start, uint32 length, values);\n\
+      \t         all other voxels take the fill value. Use densify_volume to expand to a raw volume\n");
+  fprintf(output,"--brick-size <int>\n\tThe edge length of the bricks of bricked output (default 64)\n");
+  fprintf(output,"--quantize [8 | 16]\n\tStore the output as 8 or 16 bit integers. Raw output starts with a 28 byte header (\"ADQV\", bits,\n\
+      \tfloat offset, float scale, uint32 dims), bricked and sparse output record offset and scale in their header.\n\
+      \tValues are reconstructed as offset + q*scale with an error of at most scale/2\n\
+      \twhere scale is the metric range (1 for relevance and R2) divided by 2^bits - 1\n");
   fprintf(output,"--dim <int> <int> <int>\n\tGrid size in x, y, and z dimensions\n");
+  fprintf(output,"--roi <int> <int> <int> <int> <int> <int>\n\tOnly read and process the box [x0,x1) x [y0,y1) x [z0,z1) given as x0 y0 z0 x1 y1 z1\n");
+  fprintf(output,"--roi-output <string>\n\
+      \tcrop: The output covers only the region of interest (default)\n\
+      \tfull: The output has the size of the full volume with fill values outside the region\n");
+  fprintf(output,"--no-mmap\n\tRead the input into memory rather than memory mapping it\n");
+  fprintf(output,"--dtype <string>\n\tType of the input values: uint8, uint16, int32, float16, float32 (default), or double.\n\
+      \tValues are converted to float while loading (int32 and double may lose precision)\n");
+  fprintf(output,"--offset <int>\n\tNumber of bytes to skip at the start of the input file, e.g. a header or other variables\n");
+  fprintf(output,"--stride <int>\n\tNumber of interleaved values stored per voxel (default 1)\n");
+  fprintf(output,"--component <int>\n\tWhich of the interleaved values of each voxel to use (default 0)\n");
+  fprintf(output,"--summary-size <int>\n\tEdge length of the bricks of the min/max summary used to skip regions below the threshold\n\
+      \twhen screening and writing the output (default 16, 0 disables the summary)\n");
+  fprintf(output,"--swap-bytes\n\tThe byte order of the input file differs from the host\n");
+  fprintf(output,"--sort <string>\n\
+      \t    auto: Use a counting sort for uint8 and uint16 input and std::sort otherwise (default)\n\
+      \t generic: Always use std::sort\n\
+      \tcounting: Use a counting sort if the input type allows it\n");
 
+  fprintf(output,"--tree-cache <filename>\n\tLoad the merge tree and labels from the given cache if it matches the input file,\n\
+      \tthreshold, tree type and input options, and otherwise compute and save them. Different metrics\n\
+      \tand splits can then be evaluated without sweeping again\n");
   fprintf(output,"--tree-type [0 | 1]\n\tWhether to compute merge (0, default) or split tree (1)\n");
   fprintf(output,"--threshold <float>\n\tMinimal (merge tree) or maximal (split tree) function value considered valid\n");
+  fprintf(output,"--threshold-quantile <float>\n\tChoose the threshold such that the given fraction of the vertices with the largest\n\
+      \t(merge tree) or smallest (split tree) values is kept. Overrides --threshold\n");
 
   fprintf(output,"--split-type <string>\n\
       \tlength: Split the tree by limiting the function length in function space\n\
@@ -80,12 +115,28 @@ void print_help(FILE* output, const char* exec)
 
   fprintf(output,"--split <float>\n\tThe maximal length|size allowed for an arc\n");
 
+  fprintf(output,"--simplify <float>\n\tCancel all branches whose persistence (difference between maximum and saddle)\n\
+      \tis smaller than the given value before splitting and evaluating the metrics\n");
+  fprintf(output,"--simplify-size <int>\n\tCancel all branches with fewer vertices than the given number\n");
 
-  fprintf(output,"--metric <string>\n\
+
+  fprintf(output,"--metric <string>[,<string>...]\n\
       \trelevance: Relevance metric\n\
       \tthreshold: Standard threshold metric\n\
       \t    local: LocalThreshold metric\n\
-      \t       R2: Quality\n");
+      \t       R2: Quality\n\
+      \tSeveral comma separated metrics share a single sweep. The volume output then writes one\n\
+      \tfile <output>.<metric> per metric and the topology output one simplification sequence each\n");
+
+  fprintf(output,"--hierarchy <filename>\n\tWrite the per-voxel arc labels and the metric interval of every node so that the\n\
+      \tsegmentation of any metric level can be extracted with segment_level (one file <filename>.<metric>\n\
+      \tper metric if several are given)\n");
+
+  fprintf(output,"--persistence <filename>\n\tWrite the persistence diagram of the tree as CSV (birth,death,vertex,essential)\n");
+  fprintf(output,"--betti <filename>\n\tWrite the number of components above every critical value as CSV (threshold,components).\n\
+      \tThe count of a row holds for all thresholds up to the value of the previous row\n");
+
+  fprintf(output,"--attributes <filename>\n\tWrite the per-feature count, mean, variance, min/max, bounding box and centroid as a binary table\n");
 
 }
 
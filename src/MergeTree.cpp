@@ -64,14 +64,14 @@
 #include <cassert>
 #include <cstddef>
 #include <stack>
+#include <queue>
+#include <algorithm>
+#include <functional>
 #include "MergeTree.h"
 
-extern FunctionType* gData;
+// Thread local, so it must not be read inside OpenMP regions
+extern thread_local const FunctionType* gData;
 
-extern uint32_t gDim[3];
-
-
-std::vector<Node>* Node::sNodes = NULL;
 
 Node::Node(GlobalIndexType id, LocalIndexType i) : mIndex(id), mDown(LNULL), mUp(LNULL), mNext(i), mRep(LNULL)
 {
@@ -82,20 +82,36 @@ Node::Node(const Node& n) : mIndex(n.mIndex), mDown(n.mDown), mUp(n.mUp), mNext(
 }
 
 
-FunctionType Node::arcLength() const
+MergeTree::MergeTree()
 {
-  if (mDown == LNULL)
-    return 0;
+}
+
+void MergeTree::clear()
+{
+  mNodes.clear();
+  removeArcs(0);
 
-  return fabs(gData[mIndex] - gData[(*sNodes)[mDown].mIndex]);
+  clearFeatureIndex();
 }
 
-MergeTree::MergeTree()
+void MergeTree::removeArcs(LocalIndexType count)
 {
-  // For now there can be only a asingle merge tree
-  assert (Node::sNodes == NULL);
+  // Keep the storage of the removed arcs for the arcs added next
+  for (LocalIndexType i=count;i<mArcs.size();i++) {
+    mSpareVertices.push_back(std::vector<GlobalIndexType>());
+    mSpareVertices.back().swap(mArcs[i].mVertices);
+    mSpareVertices.back().clear();
+  }
+
+  mArcs.erase(mArcs.begin() + count,mArcs.end());
+}
+
+FunctionType MergeTree::arcLength(LocalIndexType i) const
+{
+  if (mNodes[i].down() == LNULL)
+    return 0;
 
-  Node::sNodes = &mNodes;
+  return fabs(gData[mNodes[i].index()] - gData[mNodes[mNodes[i].down()].index()]);
 }
 
 
@@ -103,10 +119,18 @@ LocalIndexType MergeTree::addCriticalPoint(GlobalIndexType id)
 {
   LocalIndexType i = (LocalIndexType)mNodes.size();
 
+  clearFeatureIndex();
+
   //fprintf(stderr,"Adding CP %d  %f\n",id,gData[id]);
 
   mNodes.push_back(Node(id,i));
-  mArcs.push_back(Arc(id));
+
+  if (mSpareVertices.empty())
+    mArcs.push_back(Arc(id));
+  else {
+    mArcs.push_back(Arc(mSpareVertices.back(),id));
+    mSpareVertices.pop_back();
+  }
 
   return i;
 }
@@ -118,6 +142,8 @@ int MergeTree::addEdge(LocalIndexType up, LocalIndexType down)
 
   assert (mNodes[up].down() == LNULL);
 
+  clearFeatureIndex();
+
   mNodes[up].down(down);
 
   if (mNodes[down].up() == LNULL) {
@@ -133,6 +159,8 @@ int MergeTree::addEdge(LocalIndexType up, LocalIndexType down)
 
 int MergeTree::removeEdge(LocalIndexType up, LocalIndexType down)
 {
+  clearFeatureIndex();
+
   // First we unlink our sibling if there are any
   if (mNodes[up].next() != up) {
 
@@ -156,10 +184,46 @@ int MergeTree::removeEdge(LocalIndexType up, LocalIndexType down)
   return 1;
 }
 
+int MergeTree::truncate(LocalIndexType count)
+{
+  LocalIndexType parent;
+
+  clearFeatureIndex();
+
+  if (count >= mNodes.size())
+    return 1;
+
+  // Detach the remaining parents of all removed nodes. Parents have lower
+  // ids than their descendant, so a parent that is kept cannot be on the
+  // sibling ring of a removed one
+  for (LocalIndexType i=count;i<mNodes.size();i++) {
+    if (mNodes[i].up() == LNULL)
+      continue;
+
+    parent = mNodes[i].up();
+    do {
+      LocalIndexType next = mNodes[parent].next();
+
+      if (parent < count) {
+        mNodes[parent].down(LNULL);
+        mNodes[parent].next(parent);
+      }
+      parent = next;
+    } while (parent != mNodes[i].up());
+  }
+
+  mNodes.erase(mNodes.begin() + count,mNodes.end());
+  removeArcs(count);
+
+  return 1;
+}
+
 int MergeTree::addVertex(GlobalIndexType v, LocalIndexType label)
 {
   assert(label < mArcs.size());
 
+  clearFeatureIndex();
+
   mArcs[label].mVertices.push_back(v);
 
   return 1;
@@ -171,6 +235,8 @@ int MergeTree::splitBySize(LocalIndexType n)
 
   LocalIndexType i = 0;
 
+  clearFeatureIndex();
+
   while (i < mArcs.size()) {
     if (mArcs[i].size() > n)
       splitArc(i,(LocalIndexType)mArcs[i].mVertices.size()/2);
@@ -188,13 +254,15 @@ int MergeTree::splitByLength(FunctionType l)
   LocalIndexType i = 0;
   LocalIndexType k=1;
 
+  clearFeatureIndex();
+
   while (i < mArcs.size()) {
-    if ((mArcs[i].size() > 1) && (mNodes[i].arcLength() > l)) {
+    if ((mArcs[i].size() > 1) && (arcLength(i) > l)) {
       k = 1;
 
       for (k=1;k<mArcs[i].size();k++) {
         //fprintf(stderr,"Vertex[%d] %d %f\n",k,mArcs[i].mVertices[k],gData[mArcs[i].mVertices[k]]);
-        if (fabs(gData[mArcs[i].mVertices[0]] - gData[mArcs[i].mVertices[k]]) > mNodes[i].arcLength()/2)
+        if (fabs(gData[mArcs[i].mVertices[0]] - gData[mArcs[i].mVertices[k]]) > arcLength(i)/2)
           break;
       }
 
@@ -245,18 +313,314 @@ int MergeTree::splitArc(LocalIndexType a, LocalIndexType pos)
   return 1;
 }
 
+int MergeTree::simplify(const Comparison& greater, FunctionType persistence, GlobalIndexType size,
+                        const std::vector<GlobalIndexType>& sizes, std::vector<LocalIndexType>& map)
+{
+  typedef std::pair<FunctionType,LocalIndexType> Leaf;
+
+  std::priority_queue<Leaf,std::vector<Leaf>,std::greater<Leaf> > leaves;
+  std::vector<GlobalIndexType> count;
+  std::vector<LocalIndexType> branch;
+  IndexComp sort_comp(gData,greater);
+  GlobalIndexType k;
+  LocalIndexType i,d,p,dd;
+  FunctionType life;
+
+  assert((size == 0) || (sizes.size() == mNodes.size()));
+
+  clearFeatureIndex();
+
+  if (size > 0)
+    count = sizes;
+
+  // The union-find of nodes. Each node initially represents itself
+  map.resize(mNodes.size());
+  for (i=0;i<mNodes.size();i++) {
+    map[i] = i;
+
+    if ((mNodes[i].up() == LNULL) && (mNodes[i].down() != LNULL))
+      leaves.push(Leaf(persistenceOf(i),i));
+  }
+
+  while (!leaves.empty()) {
+    life = leaves.top().first;
+    i = leaves.top().second;
+    leaves.pop();
+
+    // The entry is stale if the leaf has grown since it has been queued
+    d = mNodes[i].down();
+    if ((map[i] != i) || (d == LNULL) || (persistenceOf(i) != life))
+      continue;
+
+    // The leaf of the representative of the saddle survives
+    if (mNodes[d].rep() == mNodes[i].rep())
+      continue;
+
+    if ((life >= persistence) && ((size == 0) || (count[i] >= size)))
+      continue;
+
+    // Merge the leaf into the branch of the representative of its saddle
+    removeEdge(i,d);
+    branchOf(d,branch);
+    map[i] = branch[0];
+
+    // Every vertex of the leaf moves into the arc of the branch spanning
+    // its value so that all arcs keep lying below their node
+    for (k=0;k<mArcs[i].mVertices.size();k++) {
+      GlobalIndexType v = mArcs[i].mVertices[k];
+      std::vector<LocalIndexType>::iterator it = branch.begin();
+
+      while (sort_comp(v,mNodes[*it].index()))
+        it++;
+
+      mArcs[*it].mVertices.push_back(v);
+      if (size > 0)
+        count[*it]++;
+    }
+
+    // Vertices that are counted but not stored in a non-augmented arc
+    if ((size > 0) && (count[i] > mArcs[i].mVertices.size()))
+      count[branch[0]] += count[i] - mArcs[i].mVertices.size();
+    mArcs[i].mVertices.clear();
+
+    // If the saddle has become regular merge it into its last parent
+    // whose arc then continues down to the next saddle
+    p = mNodes[d].up();
+    if (mNodes[p].next() != p)
+      continue;
+
+    dd = mNodes[d].down();
+
+    removeEdge(p,d);
+    if (dd != LNULL) {
+      removeEdge(d,dd);
+      addEdge(p,dd);
+    }
+
+    // Its arc now continues the one of the parent. The vertices move
+    // right away since the parent may still be cancelled as a leaf
+    mArcs[p].mVertices.insert(mArcs[p].mVertices.end(),mArcs[d].mVertices.begin(),
+                              mArcs[d].mVertices.end());
+    mArcs[d].mVertices.clear();
+
+    map[d] = p;
+    if (size > 0)
+      count[p] += count[d];
+
+    // A leaf has changed its persistence
+    if ((mNodes[p].up() == LNULL) && (dd != LNULL))
+      leaves.push(Leaf(persistenceOf(p),p));
+  }
+
+  // Compress the paths so that map points to the surviving nodes
+  for (i=0;i<map.size();i++) {
+    p = map[i];
+    while (map[p] != p)
+      p = map[p];
+    map[i] = p;
+  }
+
+  // Compact the surviving nodes in their original order
+  std::vector<LocalIndexType> index(mNodes.size(),LNULL);
+  std::vector<Node> nodes;
+  std::vector<Arc> arcs;
+
+  for (i=0;i<mNodes.size();i++) {
+    if (map[i] == i) {
+      index[i] = (LocalIndexType)nodes.size();
+      nodes.push_back(Node(mNodes[i].index(),index[i]));
+      arcs.push_back(Arc(mNodes[i].index()));
+    }
+  }
+
+  for (i=0;i<mNodes.size();i++)
+    map[i] = index[map[i]];
+
+  // All vertices of removed nodes have been moved into surviving arcs
+  for (i=0;i<mNodes.size();i++) {
+    if (index[i] != LNULL)
+      arcs[index[i]].mVertices.swap(mArcs[i].mVertices);
+  }
+
+  for (i=0;i<arcs.size();i++)
+    std::sort(arcs[i].mVertices.begin() + 1,arcs[i].mVertices.end(),sort_comp);
+
+  std::vector<Node> old;
+  old.swap(mNodes);
+  mNodes.swap(nodes);
+  mArcs.swap(arcs);
+
+  for (i=0;i<old.size();i++) {
+    if (index[i] == LNULL)
+      continue;
+
+    mNodes[index[i]].rep(map[old[i].rep()]);
+
+    if (old[i].down() != LNULL)
+      addEdge(index[i],map[old[i].down()]);
+  }
+
+  return 1;
+}
+
+void MergeTree::branchOf(LocalIndexType d, std::vector<LocalIndexType>& branch) const
+{
+  LocalIndexType p;
+
+  branch.clear();
+
+  // Climb through the parents carrying the representative until we reach it
+  while (mNodes[d].up() != LNULL) {
+    p = mNodes[d].up();
+    while (mNodes[p].rep() != mNodes[d].rep())
+      p = mNodes[p].next();
+
+    branch.push_back(p);
+    d = p;
+  }
+}
+
+FunctionType MergeTree::persistenceOf(LocalIndexType i) const
+{
+  return fabs(gData[mNodes[mNodes[i].rep()].index()] - gData[mNodes[mNodes[i].down()].index()]);
+}
+
 void MergeTree::constructFeature(LocalIndexType label, std::vector<GlobalIndexType>& feature) const
 {
-  feature.insert(feature.end(),mArcs[label].mVertices.begin(),mArcs[label].mVertices.end());
+  if (hasFeatureIndex()) {
+    feature.insert(feature.end(),featureBegin(label),featureBegin(label) + featureSize(label));
+    return;
+  }
 
-  if (mNodes[label].up() != LNULL) {
-    LocalIndexType up = mNodes[label].up();
-    do {
-      constructFeature(up,feature);
+  // Traverse the subtree depth first visiting the parents in the order
+  // of their sibling ring
+  std::vector<LocalIndexType> front(1,label);
+  std::vector<LocalIndexType> parents;
+  LocalIndexType top,up;
+
+  while (!front.empty()) {
+    top = front.back();
+    front.pop_back();
+
+    feature.insert(feature.end(),mArcs[top].mVertices.begin(),mArcs[top].mVertices.end());
 
-      up = mNodes[up].next();
-    } while (up != mNodes[label].up());
+    if (mNodes[top].up() != LNULL) {
+      parents.clear();
+      up = mNodes[top].up();
+      do {
+        parents.push_back(up);
+        up = mNodes[up].next();
+      } while (up != mNodes[top].up());
 
+      front.insert(front.end(),parents.rbegin(),parents.rend());
+    }
+  }
+}
+
+int MergeTree::buildFeatureIndex()
+{
+  LocalIndexType n = size();
+  std::vector<LocalIndexType> order;
+  std::vector<LocalIndexType> front;
+  LocalIndexType top,up;
+  LocalIndexType i;
+
+  if (hasFeatureIndex())
+    return 1;
+
+  order.reserve(n);
+
+  // Collect all nodes in depth first order starting from the roots
+  for (i=0;i<n;i++) {
+    if (mNodes[i].down() != LNULL)
+      continue;
+
+    front.push_back(i);
+    while (!front.empty()) {
+      top = front.back();
+      front.pop_back();
+      order.push_back(top);
+
+      if (mNodes[top].up() != LNULL) {
+        size_t first = front.size();
+
+        up = mNodes[top].up();
+        do {
+          front.push_back(up);
+          up = mNodes[up].next();
+        } while (up != mNodes[top].up());
+
+        std::reverse(front.begin() + first,front.end());
+      }
+    }
+  }
+
+  // Accumulate the sizes of the subtrees in reverse depth first order
+  // since parents always come after their descendant
+  mFeatureSize.resize(n);
+  for (i=0;i<n;i++)
+    mFeatureSize[i] = mArcs[i].size();
+
+  for (LocalIndexType k=n;k-- > 0;) {
+    LocalIndexType down = mNodes[order[k]].down();
+    if (down != LNULL)
+      mFeatureSize[down] += mFeatureSize[order[k]];
+  }
+
+  // Each subtree starts with the arc of its node followed by the subtrees
+  // of its parents, so the offsets follow in depth first order
+  mFeatureBegin.resize(n);
+  GlobalIndexType offset = 0;
+
+  for (LocalIndexType k=0;k<n;k++) {
+    mFeatureBegin[order[k]] = offset;
+    offset += mArcs[order[k]].size();
+  }
+
+  mFeatureVertices.resize(offset);
+
+  // Move rather than copy the vertices so they are stored only once
+#pragma omp parallel for schedule(dynamic,64)
+  for (int64_t k=0;k<(int64_t)n;k++) {
+    std::copy(mArcs[k].mVertices.begin(),mArcs[k].mVertices.end(),
+              mFeatureVertices.begin() + mFeatureBegin[k]);
+    std::vector<GlobalIndexType>().swap(mArcs[k].mVertices);
+  }
+
+  return 1;
+}
+
+GlobalIndexType MergeTree::arcSize(LocalIndexType i) const
+{
+  if (!hasFeatureIndex())
+    return mArcs[i].size();
+
+  // The subtree of the first parent directly follows the arc
+  if (mNodes[i].up() == LNULL)
+    return mFeatureSize[i];
+
+  return mFeatureBegin[mNodes[i].up()] - mFeatureBegin[i];
+}
+
+const GlobalIndexType* MergeTree::arcBegin(LocalIndexType i) const
+{
+  if (!hasFeatureIndex())
+    return mArcs[i].mVertices.data();
+
+  return mFeatureVertices.data() + mFeatureBegin[i];
+}
+
+void MergeTree::clearFeatureIndex()
+{
+  if (hasFeatureIndex()) {
+    // Return the vertices to the arcs that still exist
+#pragma omp parallel for schedule(dynamic,64)
+    for (int64_t k=0;k<(int64_t)mArcs.size();k++)
+      mArcs[k].mVertices.assign(arcBegin(k),arcBegin(k) + arcSize(k));
+
+    std::vector<GlobalIndexType>().swap(mFeatureVertices);
+    std::vector<GlobalIndexType>().swap(mFeatureBegin);
+    std::vector<GlobalIndexType>().swap(mFeatureSize);
   }
 }
 
@@ -66,17 +66,16 @@
 
 #include <vector>
 #include <cmath>
+#include <cassert>
 
 #include "Definitions.h"
+#include "Comparisons.h"
 
 //! The node of a merge tree
 class Node
 {
 public:
 
-  //! A reference ot the vector of nodes
-  static std::vector<Node>* sNodes;
-
   //! Default constructor
   Node(GlobalIndexType id, LocalIndexType i);
 
@@ -116,9 +115,6 @@ public:
   //! Set the metric value
   void metric(FunctionType m) {mMetric = m;}
 
-  //! Return the current length of the arc
-  FunctionType arcLength() const;
-
 private:
 
   //! The global index of vertex corresponding to this node
@@ -148,8 +144,8 @@ public:
   //! Default constructor
   Arc(GlobalIndexType id) : mVertices(1,id) {}
 
-  //! Copy constructor
-  Arc(const Arc& a) : mVertices(a.mVertices) {}
+  //! Constructor taking over the given (empty) storage
+  Arc(std::vector<GlobalIndexType>& storage, GlobalIndexType id) {mVertices.swap(storage);mVertices.push_back(id);}
 
   //! Return the current size of the arc
   GlobalIndexType size() const {return mVertices.size();}
@@ -171,6 +167,9 @@ public:
 	//! Destructor
 	~MergeTree() {}
 
+	//! Remove all nodes and arcs but keep the allocated storage
+	void clear();
+
 	//! Return the number of nodes/arcs
 	LocalIndexType size() const {return (LocalIndexType)mNodes.size();}
 
@@ -180,11 +179,17 @@ public:
   //! Return a reference to the i'th node
   const Node& node(LocalIndexType i) const {return mNodes[i];}
 
-  //! Return a reference to the i'th node
-  Arc& arc(LocalIndexType i) {return mArcs[i];}
+  //! Return a reference to the i'th arc (requires that no feature index exists)
+  Arc& arc(LocalIndexType i) {assert(!hasFeatureIndex());return mArcs[i];}
 
-  //! Return a reference to the i'th node
-  const Arc& arc(LocalIndexType i) const {return mArcs[i];}
+  //! Return a reference to the i'th arc (requires that no feature index exists)
+  const Arc& arc(LocalIndexType i) const {assert(!hasFeatureIndex());return mArcs[i];}
+
+  //! Return the number of vertices of the i'th arc
+  GlobalIndexType arcSize(LocalIndexType i) const;
+
+  //! Return the first vertex of the i'th arc
+  const GlobalIndexType* arcBegin(LocalIndexType i) const;
 
 	//! Return the minimum
 	FunctionType minimum() const {return mMinimum;}
@@ -198,6 +203,9 @@ public:
 	//! Set the maximum
 	void maximum(FunctionType f) {mMaximum = f;}
 
+  //! Return the current length of the i'th arc in function space
+  FunctionType arcLength(LocalIndexType i) const;
+
 	//! Add a critical point which adds both a new node and the corresponding arc
 	LocalIndexType addCriticalPoint(GlobalIndexType id);
 
@@ -207,18 +215,75 @@ public:
   //! Remove an edge
   int removeEdge(LocalIndexType up, LocalIndexType down);
 
+  //! Remove all nodes from the given one onward together with their arcs
+  /*! Since every node is created after its parents, the remaining nodes
+   *  form a valid tree in which the parents of removed nodes become
+   *  roots. The vertices the sweep has added to the remaining arcs are
+   *  left untouched.
+   * @param count The number of nodes to keep
+   * @return 1 if successful 0 otherwise
+   */
+  int truncate(LocalIndexType count);
+
 	//! Add the given vertex to the arc with the given label
 	int addVertex(GlobalIndexType v, LocalIndexType label);
 
 	//! Split all arcs with more than n vertices
 	int splitBySize(LocalIndexType n);
 
+  //! Cancel all leaf branches below the given persistence or size
+  /*! Leaves are cancelled in order of increasing persistence, i.e. the
+   *  function difference between their maximum and their saddle, unless
+   *  they carry the representative of the saddle. Following the elder
+   *  rule a cancelled leaf is merged into the surviving branch, i.e. the
+   *  path from its saddle up to the representative, and each of its
+   *  vertices moves into the arc of that branch spanning its value. A
+   *  saddle left with a single parent is merged into that parent.
+   *  Afterwards the remaining nodes are compacted in their original
+   *  order and the arcs reassembled, keeping the node vertex first and
+   *  all other vertices in descending order.
+   * @param greater The comparison defining the tree type
+   * @param persistence Cancel leaves whose persistence is smaller than this
+   * @param size Cancel leaves whose arcs contain fewer vertices than this
+   * @param sizes The number of vertices of each arc (only needed if size > 0)
+   * @param map Returns the index of the node each former node now belongs
+   *            to. A cancelled leaf maps to the lowest arc of its surviving
+   *            branch, so for augmented trees the exact label of each
+   *            vertex follows from the arcs instead
+   * @return 1 if successful 0 otherwise
+   */
+  int simplify(const Comparison& greater, FunctionType persistence, GlobalIndexType size,
+               const std::vector<GlobalIndexType>& sizes, std::vector<LocalIndexType>& map);
+
 	//! Split all arcs with length longer than l
 	int splitByLength(FunctionType l);
 
 	//! Construct a feature by assembling all vertices that belong to it
 	void constructFeature(LocalIndexType label, std::vector<GlobalIndexType>& feature) const;
 
+  //! Lay out the vertices of all arcs in depth first order
+  /*! Every subtree then occupies a contiguous range of a single array in
+   *  the same order constructFeature assembles it, so features can be
+   *  accessed without copies and their sizes in O(1). The vertices move
+   *  into the layout rather than being copied, so while it exists arcs
+   *  are only accessible through arcBegin and arcSize. Modifying the tree
+   *  moves them back.
+   * @return 1 if successful 0 otherwise
+   */
+  int buildFeatureIndex();
+
+  //! Return whether the feature layout is available
+  bool hasFeatureIndex() const {return !mFeatureBegin.empty();}
+
+  //! Move the vertices back into the arcs and discard the feature layout
+  void clearFeatureIndex();
+
+  //! Return the first vertex of the feature of the given node (requires the feature index)
+  const GlobalIndexType* featureBegin(LocalIndexType i) const {return &mFeatureVertices[mFeatureBegin[i]];}
+
+  //! Return the number of vertices of the feature of the given node (requires the feature index)
+  GlobalIndexType featureSize(LocalIndexType i) const {return mFeatureSize[i];}
+
 	//! Inflate the metric values
 	int inflate();
 
@@ -233,6 +298,21 @@ private:
 	//! The vector of arcs
 	std::vector<Arc> mArcs;
 
+  //! The vertices of all arcs in depth first order
+  std::vector<GlobalIndexType> mFeatureVertices;
+
+  //! The first entry in mFeatureVertices of the feature of each node
+  std::vector<GlobalIndexType> mFeatureBegin;
+
+  //! The number of vertices of the feature of each node
+  std::vector<GlobalIndexType> mFeatureSize;
+
+  //! The emptied vertex storage of removed arcs reused by new arcs
+  std::vector<std::vector<GlobalIndexType> > mSpareVertices;
+
+  //! Remove all arcs from count on keeping their storage
+  void removeArcs(LocalIndexType count);
+
 	//! The highest function value in the tree
 	FunctionType mMaximum;
 
@@ -242,6 +322,12 @@ private:
 
 	//! Split the given arc with pos becoming the head of the new arc
 	int splitArc(LocalIndexType a,LocalIndexType pos);
+
+  //! Return the function difference between the representative of a node and its descendant
+  FunctionType persistenceOf(LocalIndexType i) const;
+
+  //! Collect the nodes above d leading to its representative ordered from d upward
+  void branchOf(LocalIndexType d, std::vector<LocalIndexType>& branch) const;
 };
 
 
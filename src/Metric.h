@@ -67,6 +67,7 @@
 #include <assert.h>
 #include <cstddef>
 #include <map>
+#include <algorithm>
 
 #include "Definitions.h"
 #include "MergeTree.h"
@@ -93,6 +94,18 @@ public:
     mTree = tree;
   }
 
+  //! Return the range of values (including the fill value) the metric can take
+  virtual void range(FunctionType& low, FunctionType& high) const {
+    low = std::min(std::min(mTree->minimum(),mTree->maximum()),mDefault);
+    high = std::max(std::max(mTree->minimum(),mTree->maximum()),mDefault);
+  }
+
+  //! Return whether the metric decreases from the leaves towards the roots of the tree
+  /*! This holds for metrics like relevance and the inflated R2 that are
+   *  largest at the maxima regardless of the tree type
+   */
+  virtual bool descending(const Comparison& /*greater*/) const {return true;}
+
   //! Evaluate the metric at vertex id with the given label
   virtual FunctionType eval(GlobalIndexType id, LocalIndexType label) const {assert(false);return 0;}
 
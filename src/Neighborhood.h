@@ -121,6 +121,9 @@ public:
   iterator begin(GlobalIndexType origin);
   iterator end(GlobalIndexType origin);
 
+  //! Return the number of neighbors of a vertex
+  uint8_t size() const {return mCount;}
+
 protected:
 
   int8_t* mNeighbors;
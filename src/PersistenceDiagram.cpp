@@ -0,0 +1,158 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#include <algorithm>
+
+#include "PersistenceDiagram.h"
+
+//! Order pairs by their birth
+class PairComp
+{
+public:
+
+  PairComp(const Comparison& greater) : mGreater(greater) {}
+
+  bool operator()(const PersistencePair& a, const PersistencePair& b) const {
+    return mGreater(a.birth,b.birth) || ((a.birth == b.birth) && (a.vertex < b.vertex));
+  }
+
+private:
+
+  const Comparison& mGreater;
+};
+
+int PersistenceDiagram::compute(const MergeTree& tree, const FunctionType* data,
+                                const Comparison& greater, FunctionType threshold)
+{
+  LocalIndexType n = tree.size();
+  std::vector<LocalIndexType> deaths(n,0);
+  PersistencePair pair;
+  LocalIndexType i;
+
+  mGreater = &greater;
+  mPairs.clear();
+  mCurve.clear();
+
+  // Nodes that carry a different representative than their descendant
+  // end a branch, roots end the essential ones
+  for (i=0;i<n;i++) {
+    LocalIndexType down = tree.node(i).down();
+    LocalIndexType rep = tree.node(i).rep();
+
+    if ((down != LNULL) && (tree.node(down).rep() == rep))
+      continue;
+
+    pair.vertex = tree.node(rep).index();
+    pair.birth = data[pair.vertex];
+    pair.essential = (down == LNULL);
+    pair.death = pair.essential ? threshold : data[tree.node(down).index()];
+
+    mPairs.push_back(pair);
+
+    if (!pair.essential)
+      deaths[down]++;
+  }
+
+  // Walk down the critical values in the order the sweep has created
+  // the nodes. Before the nodes of a value are processed the count is
+  // the one of the threshold at that value
+  GlobalIndexType count = 0;
+  i = 0;
+  while (i < n) {
+    FunctionType value = data[tree.node(i).index()];
+
+    mCurve.push_back(std::make_pair(value,count));
+
+    for (;(i < n) && (data[tree.node(i).index()] == value);i++) {
+      if (tree.node(i).rep() == i)
+        count++;
+      count -= deaths[i];
+    }
+  }
+
+  mCurve.push_back(std::make_pair(threshold,count));
+
+  return 1;
+}
+
+int PersistenceDiagram::writePairs(FILE* output) const
+{
+  std::vector<PersistencePair> pairs(mPairs);
+
+  std::sort(pairs.begin(),pairs.end(),PairComp(*mGreater));
+
+  fprintf(output,"birth,death,vertex,essential\n");
+  for (size_t i=0;i<pairs.size();i++)
+    fprintf(output,"%.9g,%.9g,%llu,%d\n",pairs[i].birth,pairs[i].death,
+            (unsigned long long)pairs[i].vertex,pairs[i].essential ? 1 : 0);
+
+  return 1;
+}
+
+int PersistenceDiagram::writeCurve(FILE* output) const
+{
+  fprintf(output,"threshold,components\n");
+  for (size_t i=0;i<mCurve.size();i++)
+    fprintf(output,"%.9g,%llu\n",mCurve[i].first,(unsigned long long)mCurve[i].second);
+
+  return 1;
+}
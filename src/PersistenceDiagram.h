@@ -0,0 +1,140 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#ifndef PERSISTENCEDIAGRAM_H
+#define PERSISTENCEDIAGRAM_H
+
+#include <cstdio>
+#include <vector>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "MergeTree.h"
+
+//! A (birth, death) pair of a branch of the merge tree
+struct PersistencePair
+{
+  //! The function value of the maximum (merge tree) or minimum (split tree)
+  FunctionType birth;
+
+  //! The function value of the saddle or the threshold for essential branches
+  FunctionType death;
+
+  //! The index of the extremum
+  GlobalIndexType vertex;
+
+  //! Whether the branch survives down to the threshold
+  bool essential;
+};
+
+//! The persistence diagram and the number of components as a function of the threshold
+/*! Following the elder rule a branch dies at the first node where it
+ *  no longer carries the representative of the descendant. Since the
+ *  sweep creates the nodes in sorted order the component count of every
+ *  threshold follows from a single pass over the nodes: the number of
+ *  components above t is the number of branches born above t that have
+ *  not yet died above t.
+ */
+class PersistenceDiagram
+{
+public:
+
+  //! Default constructor
+  PersistenceDiagram() : mGreater(NULL) {}
+
+  //! Destructor
+  ~PersistenceDiagram() {}
+
+  //! Compute the pairs and the component counts of the given tree
+  /*!
+   * @param tree The merge or split tree with its nodes in sweep order, i.e. before splitting
+   * @param data The function values
+   * @param greater The comparison defining the tree type
+   * @param threshold The threshold of the sweep
+   * @return 1 if successful 0 otherwise
+   */
+  int compute(const MergeTree& tree, const FunctionType* data, const Comparison& greater,
+              FunctionType threshold);
+
+  //! Write the pairs as CSV (birth,death,vertex,essential) ordered by birth
+  int writePairs(FILE* output) const;
+
+  //! Write the component count curve as CSV (threshold,components)
+  /*! Each row gives the number of components above the threshold which
+   *  remains constant up to the threshold of the previous row
+   */
+  int writeCurve(FILE* output) const;
+
+private:
+
+  //! The comparison defining the tree type
+  const Comparison* mGreater;
+
+  //! The pairs
+  std::vector<PersistencePair> mPairs;
+
+  //! The distinct critical values in sweep order and the number of components above them
+  std::vector<std::pair<FunctionType,GlobalIndexType> > mCurve;
+};
+
+
+#endif /* PERSISTENCEDIAGRAM_H_ */
@@ -0,0 +1,198 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Pipeline.h"
+
+//! Return the current time in seconds
+static double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StageQueue::push(uint32_t slot)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mSlots.push_back(slot);
+  mChanged.notify_one();
+}
+
+int StageQueue::pop(uint32_t& slot)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mChanged.wait(lock,[this]() {return !mSlots.empty() || mClosed;});
+
+  if (mSlots.empty())
+    return 0;
+
+  slot = mSlots.front();
+  mSlots.pop_front();
+
+  return 1;
+}
+
+void StageQueue::close()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mClosed = true;
+  mChanged.notify_all();
+}
+
+Pipeline::Pipeline(uint32_t slots) : mSlots(std::max(slots,(uint32_t)1)), mItems(mSlots,0), mSeconds(0)
+{
+}
+
+void Pipeline::addStage(const char* name, StageFunction function, uint32_t threads)
+{
+  mStages.push_back(Stage(name,function,threads));
+}
+
+void Pipeline::run(uint32_t count)
+{
+  // The i'th queue feeds the i'th stage. The first queue holds the free
+  // slots which the last stage returns
+  std::vector<StageQueue> queues(mStages.size());
+  std::vector<std::thread> threads;
+
+  for (uint32_t s=0;s<mSlots;s++)
+    queues[0].push(s);
+
+  for (uint32_t i=0;i<mStages.size();i++) {
+    mStages[i].mItems = 0;
+    mStages[i].mBusy = 0;
+    mStages[i].mWaiting = 0;
+  }
+
+  double start = now();
+
+  for (uint32_t i=0;i<mStages.size();i++)
+    threads.push_back(std::thread(&Pipeline::runStage,this,i,std::ref(queues),count));
+
+  for (uint32_t i=0;i<threads.size();i++)
+    threads[i].join();
+
+  mSeconds = now() - start;
+}
+
+void Pipeline::runStage(uint32_t i, std::vector<StageQueue>& queues, uint32_t count)
+{
+  Stage& stage = mStages[i];
+  StageQueue& output = queues[(i + 1) % queues.size()];
+  bool last = (i + 1 == queues.size());
+  uint32_t slot;
+
+#ifdef _OPENMP
+  if (stage.mThreads > 0)
+    omp_set_num_threads(stage.mThreads);
+#endif
+
+  while ((i > 0) || (stage.mItems < count)) {
+    double start = now();
+
+    if (queues[i].pop(slot) == 0)
+      break;
+
+    // The first stage assigns the next item to the free slot. The queues
+    // order this write before any access of the later stages
+    if (i == 0)
+      mItems[slot] = stage.mItems;
+
+    double begin = now();
+    stage.mWaiting += begin - start;
+
+    stage.mFunction(slot,mItems[slot]);
+
+    stage.mBusy += now() - begin;
+    stage.mItems++;
+
+    output.push(slot);
+  }
+
+  // The free slots are never closed since the first stage counts its items
+  if (!last)
+    output.close();
+}
+
+void Pipeline::report(FILE* output) const
+{
+  fprintf(output,"Stage       items   busy [s]   waiting [s]   utilization\n");
+
+  for (uint32_t i=0;i<mStages.size();i++) {
+    const Stage& stage = mStages[i];
+
+    fprintf(output,"%-10s %6u %10.3f %13.3f %12.1f%%\n",stage.mName.c_str(),stage.mItems,stage.mBusy,
+            stage.mWaiting,(mSeconds > 0) ? 100*stage.mBusy / mSeconds : 0);
+  }
+
+  fprintf(output,"Total %.3f s with %u slots\n",mSeconds,mSlots);
+}
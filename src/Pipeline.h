@@ -0,0 +1,192 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstdio>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+//! A queue passing slots from one stage of a Pipeline to the next
+/*! The queue never holds more than the number of slots of the pipeline
+ *  so its size is bounded by construction.
+ */
+class StageQueue
+{
+public:
+
+  //! Default constructor
+  StageQueue() : mClosed(false) {}
+
+  //! Append the given slot
+  void push(uint32_t slot);
+
+  //! Wait for the next slot
+  /*! @return 1 if a slot was returned and 0 once the queue is closed and empty */
+  int pop(uint32_t& slot);
+
+  //! Signal that no more slots will be pushed
+  void close();
+
+private:
+
+  //! The slots in order
+  std::deque<uint32_t> mSlots;
+
+  //! Whether more slots will be pushed
+  bool mClosed;
+
+  //! Lock protecting the queue
+  std::mutex mMutex;
+
+  //! Signal that a slot has been pushed or the queue closed
+  std::condition_variable mChanged;
+};
+
+//! A sequence of stages through which items are passed in order
+/*! Every stage runs in its own thread. The items are stored in a fixed
+ *  number of slots owned by the caller which circulate through the
+ *  stages and return to the first one once the last stage has finished
+ *  with them. With n slots at most n consecutive items are in flight,
+ *  e.g. item t+1 is read while t is processed and t-1 written, which
+ *  bounds the memory while keeping I/O and compute stages busy. Each
+ *  stage records the time it spends working and waiting for input.
+ */
+class Pipeline
+{
+public:
+
+  //! The function of a stage processing the given item stored in the given slot
+  typedef std::function<void (uint32_t slot, uint32_t item)> StageFunction;
+
+  //! Constructor
+  /*! @param slots The number of items that may be in flight at once */
+  Pipeline(uint32_t slots);
+
+  //! Append a stage
+  /*!
+   * @param name The name used in the report
+   * @param function The function processing one item
+   * @param threads The number of OpenMP threads of the stage or 0 for the default
+   */
+  void addStage(const char* name, StageFunction function, uint32_t threads=0);
+
+  //! Pass the items 0, ..., count-1 through all stages and wait until they are done
+  void run(uint32_t count);
+
+  //! Print the utilization of all stages
+  void report(FILE* output) const;
+
+private:
+
+  //! A stage and its statistics
+  class Stage
+  {
+  public:
+
+    //! Constructor
+    Stage(const char* name, StageFunction function, uint32_t threads) :
+      mName(name), mFunction(function), mThreads(threads), mItems(0), mBusy(0), mWaiting(0) {}
+
+    //! The name of the stage
+    std::string mName;
+
+    //! The function processing one item
+    StageFunction mFunction;
+
+    //! The number of OpenMP threads or 0
+    uint32_t mThreads;
+
+    //! The number of items processed
+    uint32_t mItems;
+
+    //! The time spent processing items in seconds
+    double mBusy;
+
+    //! The time spent waiting for the previous stage (or a free slot) in seconds
+    double mWaiting;
+  };
+
+  //! The number of slots
+  uint32_t mSlots;
+
+  //! The item currently stored in each slot
+  std::vector<uint32_t> mItems;
+
+  //! The stages in order
+  std::vector<Stage> mStages;
+
+  //! The duration of the last run in seconds
+  double mSeconds;
+
+  //! The main loop of the i'th stage
+  void runStage(uint32_t i, std::vector<StageQueue>& queues, uint32_t count);
+};
+
+#endif /* PIPELINE_H */
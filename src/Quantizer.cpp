@@ -0,0 +1,204 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "Quantizer.h"
+
+//! The identifier at the beginning of a quantized volume
+static const char gQuantizerMagic[4] = {'A','D','Q','V'};
+
+//! Quantize a single value
+template <typename T>
+static inline T quantize(FunctionType v, double offset, double inverse, double top)
+{
+  double q = (v - offset) * inverse + 0.5;
+
+  // The comparisons also map NaN to 0
+  if (!(q > 0))
+    q = 0;
+  else if (q > top)
+    q = top;
+
+  return (T)q;
+}
+
+int Quantizer::initialize(FunctionType low, FunctionType high, uint32_t bits)
+{
+  if ((bits != 8) && (bits != 16)) {
+    fprintf(stderr,"Error, quantization to %d bits is not supported\n",bits);
+    return 0;
+  }
+
+  mBits = bits;
+  mOffset = low;
+  double scale = ((double)high - low) / ((1 << bits) - 1);
+  mScale = (FunctionType)scale;
+
+  // Round the scale up so the quantized values still cover [low,high]
+  if (mScale < scale)
+    mScale = std::nextafter(mScale,std::numeric_limits<FunctionType>::max());
+
+  // A constant volume still needs a valid scale
+  if (!(mScale > 0))
+    mScale = 1;
+
+  return 1;
+}
+
+FunctionType Quantizer::errorBound() const
+{
+  double top = (double)((1 << mBits) - 1);
+  FunctionType largest = (FunctionType)std::max(std::fabs((double)mOffset),
+                                                std::fabs(mOffset + top*mScale));
+
+  // The decoded value is exact in double and rounded to float once
+  double ulp = std::nextafter(largest,std::numeric_limits<FunctionType>::max()) - largest;
+  double bound = mScale / 2.0 + ulp / 2;
+
+  // Make sure the returned float does not round the bound down
+  FunctionType result = (FunctionType)bound;
+  if (result < bound)
+    result = std::nextafter(result,std::numeric_limits<FunctionType>::max());
+
+  return result;
+}
+
+void Quantizer::header(const GlobalIndexType dim[3], char* buffer) const
+{
+  uint32_t d[3] = {(uint32_t)dim[0],(uint32_t)dim[1],(uint32_t)dim[2]};
+  float offset = (float)mOffset;
+  float scale = (float)mScale;
+
+  memcpy(buffer,gQuantizerMagic,4);
+  memcpy(buffer+4,&mBits,sizeof(uint32_t));
+  memcpy(buffer+8,&offset,sizeof(float));
+  memcpy(buffer+12,&scale,sizeof(float));
+  memcpy(buffer+16,d,3*sizeof(uint32_t));
+}
+
+int Quantizer::parseHeader(const char* buffer, GlobalIndexType dim[3])
+{
+  uint32_t d[3];
+  float offset,scale;
+
+  if (memcmp(buffer,gQuantizerMagic,4) != 0)
+    return 0;
+
+  memcpy(&mBits,buffer+4,sizeof(uint32_t));
+  memcpy(&offset,buffer+8,sizeof(float));
+  memcpy(&scale,buffer+12,sizeof(float));
+  memcpy(d,buffer+16,3*sizeof(uint32_t));
+
+  if ((mBits != 8) && (mBits != 16))
+    return 0;
+
+  mOffset = offset;
+  mScale = scale;
+  dim[0] = d[0];
+  dim[1] = d[1];
+  dim[2] = d[2];
+
+  return 1;
+}
+
+void Quantizer::encode(const FunctionType* values, void* output, size_t count) const
+{
+  // Rounding is done in double precision so the error bound is not
+  // exceeded for 16 bit values
+  double inverse = 1.0 / mScale;
+  double top = (double)((1 << mBits) - 1);
+
+  if (mBits == 8) {
+    uint8_t* out = (uint8_t*)output;
+    for (size_t i=0;i<count;i++)
+      out[i] = quantize<uint8_t>(values[i],mOffset,inverse,top);
+  }
+  else {
+    uint16_t* out = (uint16_t*)output;
+    for (size_t i=0;i<count;i++)
+      out[i] = quantize<uint16_t>(values[i],mOffset,inverse,top);
+  }
+}
+
+void Quantizer::decode(const void* input, FunctionType* values, size_t count) const
+{
+  // Reconstruct in double so only the final conversion to float rounds
+  double offset = mOffset;
+  double scale = mScale;
+
+  if (mBits == 8) {
+    const uint8_t* in = (const uint8_t*)input;
+    for (size_t i=0;i<count;i++)
+      values[i] = (FunctionType)(offset + in[i]*scale);
+  }
+  else {
+    const uint16_t* in = (const uint16_t*)input;
+    for (size_t i=0;i<count;i++)
+      values[i] = (FunctionType)(offset + in[i]*scale);
+  }
+}
@@ -0,0 +1,144 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "Definitions.h"
+
+//! Linear quantization of metric values to 8 or 16 bits
+/*! A value v in [low,high] is stored as the integer
+ *  q = round((v - offset) / scale) with offset = low and
+ *  scale = (high - low) / (2^bits - 1) rounded up to float. The
+ *  reconstructed value offset + q*scale differs from v by at most scale/2
+ *  before it is rounded to float, which adds at most half an ulp of the
+ *  largest reconstructed magnitude. Values outside the range are clamped.
+ */
+class Quantizer
+{
+public:
+
+  //! Default constructor creating an identity mapping with no bits
+  Quantizer() : mBits(0), mOffset(0), mScale(1) {}
+
+  //! Initialize the mapping of [low,high] onto the given number of bits
+  int initialize(FunctionType low, FunctionType high, uint32_t bits);
+
+  //! Set the mapping directly, e.g. from a file header
+  void mapping(uint32_t bits, FunctionType offset, FunctionType scale) {
+    mBits = bits;
+    mOffset = offset;
+    mScale = scale;
+  }
+
+  //! Return the number of bits per value
+  uint32_t bits() const {return mBits;}
+
+  //! Return the number of bytes per value
+  size_t bytes() const {return mBits / 8;}
+
+  //! Return the offset
+  FunctionType offset() const {return mOffset;}
+
+  //! Return the scale
+  FunctionType scale() const {return mScale;}
+
+  //! Return the maximal absolute reconstruction error including the float rounding
+  FunctionType errorBound() const;
+
+  //! The size of the header written in front of a quantized volume
+  static const size_t sHeaderSize = 28;
+
+  //! Fill the header of a quantized volume of the given dimensions
+  /*! The header consists of the four characters "ADQV", the uint32 number
+   *  of bits, the float offset and scale, and the uint32 dimensions.
+   */
+  void header(const GlobalIndexType dim[3], char* buffer) const;
+
+  //! Initialize the mapping from a header and return the dimensions
+  /*! @return 1 if the header is valid 0 otherwise */
+  int parseHeader(const char* buffer, GlobalIndexType dim[3]);
+
+  //! Quantize count values into the output array of bytes()*count bytes
+  void encode(const FunctionType* values, void* output, size_t count) const;
+
+  //! Reconstruct count values from their quantized representation
+  void decode(const void* input, FunctionType* values, size_t count) const;
+
+private:
+
+  //! The number of bits per value (8 or 16)
+  uint32_t mBits;
+
+  //! The value corresponding to 0
+  FunctionType mOffset;
+
+  //! The difference between consecutive quantized values
+  FunctionType mScale;
+};
+
+
+#endif /* QUANTIZER_H_ */
@@ -69,8 +69,13 @@
 
 int R2::eval(MergeTree& tree) const
 {
+  // Access the features as contiguous ranges rather than assembling them
+  if (!tree.hasFeatureIndex())
+    tree.buildFeatureIndex();
+
   // For all nodes
-  for (LocalIndexType i=0;i<tree.size();i++) {
+#pragma omp parallel for schedule(dynamic,16)
+  for (int64_t i=0;i<(int64_t)tree.size();i++) {
     tree.node(i).metric(eval(i));
 
   }
@@ -85,39 +90,35 @@ FunctionType R2::eval(LocalIndexType label) const
   if (label == LNULL)
     return this->mDefault;
 
-  std::vector<GlobalIndexType> feature;
-  std::vector<FunctionType> values;
-
-  // Collect all vertices belonging to this feature
-  mTree->constructFeature(label,feature);
+  // All vertices belonging to this feature
+  const GlobalIndexType* feature = mTree->featureBegin(label);
+  GlobalIndexType size = mTree->featureSize(label);
 
   // If the feature has fewer than 3 vertices than a linear fit
   // is always perfect so we return 1
-  if (feature.size() < 3)
+  if (size < 3)
     return 1;
 
   // Otherwise, we determine how well the data is fit as a linear
   // function of volume, i.e. vertex count
-  values.resize(feature.size());
-
-  LocalIndexType i;
+  GlobalIndexType i;
   FunctionType mean_value = 0;
-  FunctionType mean_volume = (FunctionType)(feature.size() / 2.0);
+  FunctionType mean_volume = (FunctionType)(size / 2.0);
 
-  for (i=0;i<feature.size();i++) {
-    values[i] = mData[feature[i]];
-    mean_value += values[i];
-  }
+  for (i=0;i<size;i++)
+    mean_value += mData[feature[i]];
 
-  mean_value /= values.size();
+  mean_value /= size;
 
   FunctionType cov = 0;
   FunctionType stddev_value = 0;
   FunctionType stddev_volume = 0;
 
-  for (i=0;i<feature.size();i++) {
-    cov += (values[i] - mean_value)*(i  - mean_volume);
-    stddev_value += (values[i] - mean_value)*(values[i] - mean_value);
+  for (i=0;i<size;i++) {
+    FunctionType value = mData[feature[i]];
+
+    cov += (value - mean_value)*(i  - mean_volume);
+    stddev_value += (value - mean_value)*(value - mean_value);
     stddev_volume += (i  - mean_volume)*(i  - mean_volume);
   }
 
@@ -126,7 +127,3 @@ FunctionType R2::eval(LocalIndexType label) const
 
   return (FunctionType)std::min((double)1,pow(cov / (stddev_value*stddev_volume),2));
 }
-
-
-
-
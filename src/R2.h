@@ -75,6 +75,9 @@ public:
   //! Destructor
   virtual ~R2() {}
 
+  //! The quality of a fit is confined to [0,1]
+  virtual void range(FunctionType& low, FunctionType& high) const {low = 0; high = 1;}
+
   //! Evaluate the metric for all nodes of a tree
   virtual int eval(MergeTree& tree) const;
 
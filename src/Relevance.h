@@ -78,6 +78,9 @@ public:
   //! Destructor
   virtual ~Relevance() {}
 
+  //! Relevance is confined to [0,1]
+  virtual void range(FunctionType& low, FunctionType& high) const {low = 0; high = 1;}
+
   //! Evaluate the metric at vertex id with the given label
   virtual FunctionType eval(GlobalIndexType id, LocalIndexType label) const;
 
@@ -0,0 +1,201 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#include <cstdio>
+#include <cstring>
+
+#include "SegmentationHierarchy.h"
+
+//! The identifier at the beginning of a segmentation hierarchy
+static const char gHierarchyMagic[4] = {'A','D','S','H'};
+
+SegmentationHierarchy::SegmentationHierarchy()
+{
+  memset(&mHeader,0,sizeof(HierarchyHeader));
+}
+
+int SegmentationHierarchy::build(const MergeTree& tree, const std::vector<FunctionType>& values,
+                                 const char* metric, bool descending)
+{
+  memcpy(mHeader.magic,gHierarchyMagic,4);
+  mHeader.version = 1;
+  mHeader.nodeCount = tree.size();
+  mHeader.descending = descending ? 1 : 0;
+  strncpy(mHeader.metric,metric,sizeof(mHeader.metric)-1);
+
+  mNodes.resize(tree.size());
+
+  for (LocalIndexType i=0;i<tree.size();i++) {
+    LocalIndexType down = tree.node(i).down();
+
+    mNodes[i].down = down;
+    mNodes[i].rep = tree.node(i).rep();
+    mNodes[i].birth = values[i];
+    mNodes[i].death = (down == LNULL) ? values[i] : values[down];
+  }
+
+  return 1;
+}
+
+int SegmentationHierarchy::write(const char* filename, const LocalIndexType* labels,
+                                 const GlobalIndexType dim[3]) const
+{
+  HierarchyHeader header = mHeader;
+  GlobalIndexType count = dim[0]*dim[1]*dim[2];
+
+  for (int i=0;i<3;i++)
+    header.dim[i] = (uint32_t)dim[i];
+
+  FILE* output = fopen(filename,"wb");
+  if (output == NULL) {
+    fprintf(stderr,"Error, could not open hierarchy file \"%s\"\n",filename);
+    return 0;
+  }
+
+  bool success = (fwrite(&header,sizeof(HierarchyHeader),1,output) == 1)
+                 && (fwrite(mNodes.data(),sizeof(HierarchyNode),mNodes.size(),output) == mNodes.size())
+                 && (fwrite(labels,sizeof(LocalIndexType),count,output) == count);
+
+  if ((fclose(output) != 0) || !success) {
+    fprintf(stderr,"Error, could not write hierarchy file \"%s\"\n",filename);
+    return 0;
+  }
+
+  return 1;
+}
+
+int SegmentationHierarchy::read(const char* filename)
+{
+  FILE* input = fopen(filename,"rb");
+  if (input == NULL) {
+    fprintf(stderr,"Error, could not open hierarchy file \"%s\"\n",filename);
+    return 0;
+  }
+
+  if ((fread(&mHeader,sizeof(HierarchyHeader),1,input) != 1)
+      || (memcmp(mHeader.magic,gHierarchyMagic,4) != 0) || (mHeader.version != 1)) {
+    fprintf(stderr,"Error, \"%s\" is not a segmentation hierarchy\n",filename);
+    fclose(input);
+    return 0;
+  }
+
+  GlobalIndexType count = (GlobalIndexType)mHeader.dim[0]*mHeader.dim[1]*mHeader.dim[2];
+
+  mNodes.resize(mHeader.nodeCount);
+  mLabels.resize(count);
+
+  if ((fread(mNodes.data(),sizeof(HierarchyNode),mNodes.size(),input) != mNodes.size())
+      || (fread(mLabels.data(),sizeof(LocalIndexType),count,input) != count)) {
+    fprintf(stderr,"Error, the hierarchy file \"%s\" is truncated\n",filename);
+    fclose(input);
+    return 0;
+  }
+
+  fclose(input);
+
+  return 1;
+}
+
+void SegmentationHierarchy::features(FunctionType level, std::vector<LocalIndexType>& feature) const
+{
+  std::vector<LocalIndexType> jump(mNodes.size());
+  bool changed = true;
+
+  feature.resize(mNodes.size());
+
+  // Every node initially points to its descendant if it is merged into it
+#pragma omp parallel for schedule(static)
+  for (int64_t i=0;i<(int64_t)mNodes.size();i++) {
+    if ((mNodes[i].down != LNULL) && significant(mNodes[i].death,level))
+      jump[i] = mNodes[i].down;
+    else
+      jump[i] = (LocalIndexType)i;
+  }
+
+  // Jump until all nodes point to the lowest node of their feature
+  while (changed) {
+    changed = false;
+
+#pragma omp parallel for schedule(static) reduction(||:changed)
+    for (int64_t i=0;i<(int64_t)mNodes.size();i++) {
+      feature[i] = jump[jump[i]];
+      changed = changed || (feature[i] != jump[i]);
+    }
+
+    jump.swap(feature);
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int64_t i=0;i<(int64_t)mNodes.size();i++)
+    feature[i] = significant(mNodes[i].birth,level) ? jump[i] : LNULL;
+}
+
+void SegmentationHierarchy::segment(FunctionType level, LocalIndexType* output) const
+{
+  std::vector<LocalIndexType> feature;
+
+  features(level,feature);
+
+#pragma omp parallel for schedule(static)
+  for (int64_t v=0;v<(int64_t)mLabels.size();v++)
+    output[v] = (mLabels[v] == LNULL) ? LNULL : feature[mLabels[v]];
+}
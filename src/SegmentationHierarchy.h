@@ -0,0 +1,188 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#ifndef SEGMENTATIONHIERARCHY_H
+#define SEGMENTATIONHIERARCHY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Definitions.h"
+#include "MergeTree.h"
+
+/*! A segmentation hierarchy encodes the segmentation of all metric
+ *  levels at once. Like the segmentation of a talass family it stores the
+ *  per-voxel arc labels and for every node its descendant and the metric
+ *  interval it spans, i.e. its own metric value (birth) and the one of its
+ *  descendant (death). At level t a voxel belongs to a feature if the
+ *  metric of its arc is more significant than t and its arc is merged into
+ *  its descendant as long as the descendant is more significant as well.
+ *  The file consists of a HierarchyHeader, one HierarchyNode per node and
+ *  the uint32 labels volume.
+ */
+
+//! The fixed size header of a segmentation hierarchy
+struct HierarchyHeader
+{
+  //! The characters "ADSH"
+  char magic[4];
+
+  //! The version of the format
+  uint32_t version;
+
+  //! The dimensions of the labels volume
+  uint32_t dim[3];
+
+  //! The number of nodes
+  uint32_t nodeCount;
+
+  //! Whether the metric decreases towards the roots (1) or increases (0)
+  uint32_t descending;
+
+  //! Padding to a multiple of 8 bytes
+  uint32_t reserved;
+
+  //! The name of the metric
+  char metric[32];
+};
+
+//! A node of a segmentation hierarchy
+struct HierarchyNode
+{
+  //! The descendant or LNULL
+  uint32_t down;
+
+  //! The representative
+  uint32_t rep;
+
+  //! The metric of the node
+  float birth;
+
+  //! The metric of the descendant (or the node itself for roots)
+  float death;
+};
+
+//! Store and query the segmentation of all metric levels
+class SegmentationHierarchy
+{
+public:
+
+  //! Default constructor
+  SegmentationHierarchy();
+
+  //! Destructor
+  ~SegmentationHierarchy() {}
+
+  //! Build the hierarchy from the given tree and metric values
+  /*!
+   * @param tree The merge tree
+   * @param values The metric value of each node
+   * @param metric The name of the metric
+   * @param descending Whether the metric decreases towards the roots (see Metric::descending)
+   * @return 1 if successful 0 otherwise
+   */
+  int build(const MergeTree& tree, const std::vector<FunctionType>& values, const char* metric,
+            bool descending);
+
+  //! Write the hierarchy together with the given labels
+  int write(const char* filename, const LocalIndexType* labels, const GlobalIndexType dim[3]) const;
+
+  //! Read a hierarchy including its labels
+  int read(const char* filename);
+
+  //! Return the dimensions of the labels volume
+  const uint32_t* dim() const {return mHeader.dim;}
+
+  //! Return the name of the metric
+  const char* metric() const {return mHeader.metric;}
+
+  //! Return the number of nodes
+  LocalIndexType size() const {return (LocalIndexType)mNodes.size();}
+
+  //! Compute the feature each node belongs to at the given level
+  /*! The features are found by pointer jumping along the descendants in
+   *  parallel, nodes that are not part of any feature receive LNULL
+   */
+  void features(FunctionType level, std::vector<LocalIndexType>& feature) const;
+
+  //! Compute the feature of every voxel at the given level in one parallel pass
+  void segment(FunctionType level, LocalIndexType* output) const;
+
+private:
+
+  //! The header
+  HierarchyHeader mHeader;
+
+  //! The nodes
+  std::vector<HierarchyNode> mNodes;
+
+  //! The labels read from file
+  std::vector<LocalIndexType> mLabels;
+
+  //! Whether the value x is more significant than the level
+  bool significant(FunctionType x, FunctionType level) const {
+    return mHeader.descending ? (x > level) : (x < level);
+  }
+};
+
+
+#endif /* SEGMENTATIONHIERARCHY_H_ */
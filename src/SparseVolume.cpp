@@ -0,0 +1,261 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+
+#include "SparseVolume.h"
+
+//! The identifier at the beginning of a sparse volume
+static const char gSparseMagic[4] = {'A','D','S','V'};
+
+//! The identifier at the end of a sparse volume
+static const char gSparseEndMagic[4] = {'A','D','S','E'};
+
+SparseWriter::SparseWriter(const GlobalIndexType dim[3], const Quantizer* quantizer, FunctionType fill)
+  : mIndex(0), mRunStart(GNULL), mRunCount(0), mValueCount(0)
+{
+  memset(&mHeader,0,sizeof(SparseHeader));
+
+  memcpy(mHeader.magic,gSparseMagic,4);
+  mHeader.version = 1;
+  mHeader.dim[0] = (uint32_t)dim[0];
+  mHeader.dim[1] = (uint32_t)dim[1];
+  mHeader.dim[2] = (uint32_t)dim[2];
+  mHeader.fillValue = fill;
+
+  if ((quantizer != NULL) && (quantizer->bits() > 0)) {
+    mQuantizer = *quantizer;
+    mHeader.dataType = (quantizer->bits() == 8) ? DATA_UINT8 : DATA_UINT16;
+    mHeader.offset = quantizer->offset();
+    mHeader.scale = quantizer->scale();
+  }
+  else {
+    mHeader.dataType = DATA_FLOAT32;
+    mHeader.offset = 0;
+    mHeader.scale = 1;
+  }
+}
+
+int SparseWriter::open(const char* filename, bool direct)
+{
+  if (VolumeOutput::open(filename,direct) == 0)
+    return 0;
+
+  mIndex = 0;
+  mRunStart = GNULL;
+  mRun.clear();
+  mRunCount = 0;
+  mValueCount = 0;
+
+  return mOutput.write(&mHeader,sizeof(SparseHeader));
+}
+
+int SparseWriter::writePlane(const FunctionType* plane, const LocalIndexType* labels)
+{
+  GlobalIndexType plane_size = mHeader.dim[0]*mHeader.dim[1];
+
+  // Runs may continue across planes so the current run is only written
+  // once its end has been found
+  for (GlobalIndexType i=0;i<plane_size;i++) {
+    if (labels[i] != LNULL) {
+      if (mRun.empty())
+        mRunStart = mIndex + i;
+      mRun.push_back(plane[i]);
+
+      // The length of a run is stored as uint32
+      if ((mRun.size() == (uint32_t)(-1)) && (flushRun() == 0))
+        return 0;
+    }
+    else if (!mRun.empty() && (flushRun() == 0))
+      return 0;
+  }
+
+  mIndex += plane_size;
+
+  return 1;
+}
+
+int SparseWriter::flushRun()
+{
+  uint64_t start = mRunStart;
+  uint32_t length = (uint32_t)mRun.size();
+
+  if ((mOutput.write(&start,sizeof(uint64_t)) == 0) || (mOutput.write(&length,sizeof(uint32_t)) == 0))
+    return 0;
+
+  if (mHeader.dataType == DATA_FLOAT32) {
+    if (mOutput.write(&mRun[0],length*sizeof(FunctionType)) == 0)
+      return 0;
+  }
+  else {
+    mEncoded.resize(length*mQuantizer.bytes());
+    mQuantizer.encode(&mRun[0],&mEncoded[0],length);
+    if (mOutput.write(&mEncoded[0],mEncoded.size()) == 0)
+      return 0;
+  }
+
+  mRunCount++;
+  mValueCount += length;
+  mRun.clear();
+
+  return 1;
+}
+
+int SparseWriter::close()
+{
+  if ((!mRun.empty() && (flushRun() == 0))
+      || (mOutput.write(&mRunCount,sizeof(uint64_t)) == 0)
+      || (mOutput.write(&mValueCount,sizeof(uint64_t)) == 0)
+      || (mOutput.write(gSparseEndMagic,4) == 0)) {
+    mOutput.close();
+    return 0;
+  }
+
+  fprintf(stderr,"Stored %llu of %llu values in %llu runs\n",(unsigned long long)mValueCount,
+          (unsigned long long)mIndex,(unsigned long long)mRunCount);
+
+  return mOutput.close();
+}
+
+int read_sparse_volume(const char* filename, std::vector<FunctionType>& volume, GlobalIndexType dim[3])
+{
+  SparseHeader header;
+  Quantizer quantizer;
+  std::vector<char> encoded;
+  uint64_t start;
+  uint32_t length;
+  size_t element;
+
+  FILE* input = fopen(filename,"rb");
+  if (input == NULL) {
+    fprintf(stderr,"Error, could not open sparse volume \"%s\"\n",filename);
+    return 0;
+  }
+
+  if ((fread(&header,sizeof(SparseHeader),1,input) != 1) || (memcmp(header.magic,gSparseMagic,4) != 0)) {
+    fprintf(stderr,"Error, \"%s\" is not a sparse volume\n",filename);
+    fclose(input);
+    return 0;
+  }
+
+  dim[0] = header.dim[0];
+  dim[1] = header.dim[1];
+  dim[2] = header.dim[2];
+
+  element = data_type_size((DataType)header.dataType);
+  if (header.dataType != DATA_FLOAT32)
+    quantizer.mapping((header.dataType == DATA_UINT8) ? 8 : 16,header.offset,header.scale);
+
+  // The trailer tells us how many runs to expect
+  uint64_t run_count,value_count;
+  char tail[4];
+
+  if ((fseek(input,-(long)(2*sizeof(uint64_t) + 4),SEEK_END) != 0)
+      || (fread(&run_count,sizeof(uint64_t),1,input) != 1)
+      || (fread(&value_count,sizeof(uint64_t),1,input) != 1)
+      || (fread(tail,1,4,input) != 4) || (memcmp(tail,gSparseEndMagic,4) != 0)
+      || (fseek(input,sizeof(SparseHeader),SEEK_SET) != 0)) {
+    fprintf(stderr,"Error, sparse volume \"%s\" is truncated\n",filename);
+    fclose(input);
+    return 0;
+  }
+
+  volume.assign(dim[0]*dim[1]*dim[2],header.fillValue);
+
+  for (uint64_t r=0;r<run_count;r++) {
+
+    if ((fread(&start,sizeof(uint64_t),1,input) != 1) || (fread(&length,sizeof(uint32_t),1,input) != 1)) {
+      fprintf(stderr,"Error, sparse volume \"%s\" is truncated\n",filename);
+      fclose(input);
+      return 0;
+    }
+
+    if (start + length > volume.size()) {
+      fprintf(stderr,"Error, invalid run in sparse volume \"%s\"\n",filename);
+      fclose(input);
+      return 0;
+    }
+
+    if (header.dataType == DATA_FLOAT32) {
+      if (fread(&volume[start],sizeof(FunctionType),length,input) != length) {
+        fprintf(stderr,"Error, sparse volume \"%s\" is truncated\n",filename);
+        fclose(input);
+        return 0;
+      }
+    }
+    else {
+      encoded.resize(length*element);
+      if (fread(&encoded[0],element,length,input) != length) {
+        fprintf(stderr,"Error, sparse volume \"%s\" is truncated\n",filename);
+        fclose(input);
+        return 0;
+      }
+      quantizer.decode(&encoded[0],&volume[start],length);
+    }
+  }
+
+  fclose(input);
+
+  return 1;
+}
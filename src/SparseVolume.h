@@ -0,0 +1,176 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef SPARSEVOLUME_H
+#define SPARSEVOLUME_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "Definitions.h"
+#include "DataType.h"
+#include "Quantizer.h"
+#include "VolumeOutput.h"
+
+/*! A sparse volume stores only the values of labeled vertices. It
+ *  consists of a SparseHeader followed by a sequence of runs, each given
+ *  by its uint64 starting index, its uint32 length and the values of
+ *  its vertices. The file ends with a trailer of the uint64 number of
+ *  runs, the uint64 number of values and the characters "ADSE". All
+ *  other vertices have the fill value.
+ */
+
+//! The fixed size header of a sparse volume
+struct SparseHeader
+{
+  //! The characters "ADSV"
+  char magic[4];
+
+  //! The version of the format
+  uint32_t version;
+
+  //! The dimensions of the volume
+  uint32_t dim[3];
+
+  //! The DataType of the stored values (float32, uint8 or uint16)
+  uint32_t dataType;
+
+  //! The offset of quantized values
+  float offset;
+
+  //! The scale of quantized values
+  float scale;
+
+  //! The value of all vertices not stored
+  float fillValue;
+
+  //! Unused
+  uint32_t reserved;
+};
+
+//! Write the values of all labeled vertices as run-length encoded spans
+class SparseWriter : public VolumeOutput
+{
+public:
+
+  //! Constructor
+  /*!
+   * @param dim The dimensions of the volume
+   * @param quantizer The quantizer to encode values with or NULL to store floats
+   * @param fill The value of unlabeled vertices
+   */
+  SparseWriter(const GlobalIndexType dim[3], const Quantizer* quantizer, FunctionType fill);
+
+  //! Destructor
+  virtual ~SparseWriter() {}
+
+  //! Open the file and write the header
+  virtual int open(const char* filename, bool direct=false);
+
+  //! Add the values of all labeled vertices of the next plane
+  virtual int writePlane(const FunctionType* plane, const LocalIndexType* labels);
+
+  //! Write the last run and the trailer and close the file
+  virtual int close();
+
+private:
+
+  //! The header
+  SparseHeader mHeader;
+
+  //! The quantization used if the header says so
+  Quantizer mQuantizer;
+
+  //! The index of the first vertex of the next plane
+  GlobalIndexType mIndex;
+
+  //! The index of the first vertex of the currently open run
+  GlobalIndexType mRunStart;
+
+  //! The values of the currently open run
+  std::vector<FunctionType> mRun;
+
+  //! Buffer for encoded values
+  std::vector<char> mEncoded;
+
+  //! The number of runs written
+  uint64_t mRunCount;
+
+  //! The number of values written
+  uint64_t mValueCount;
+
+  //! Write the currently open run
+  int flushRun();
+};
+
+//! Read a sparse volume and expand it into a dense array
+/*!
+ * @param filename The name of the sparse volume
+ * @param volume The array of dim[0]*dim[1]*dim[2] values to fill
+ * @param dim The dimensions of the volume
+ * @return 1 if successful 0 otherwise
+ */
+int read_sparse_volume(const char* filename, std::vector<FunctionType>& volume, GlobalIndexType dim[3]);
+
+
+#endif /* SPARSEVOLUME_H_ */
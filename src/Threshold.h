@@ -78,6 +78,9 @@ public:
   //! Destructor
   virtual ~Threshold() {}
 
+  //! The function values decrease towards the roots of a merge tree and increase for a split tree
+  virtual bool descending(const Comparison& greater) const {return greater(1,0);}
+
   //! Evaluate the metric at vertex id with the given label
   virtual FunctionType eval(GlobalIndexType id, LocalIndexType label) const;
 
@@ -0,0 +1,289 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ThresholdSession.h"
+
+// Thread local, so they must not be read inside OpenMP regions
+extern thread_local const FunctionType* gData;
+
+extern thread_local GlobalIndexType gDim[3];
+
+ThresholdSession::ThresholdSession(const Comparison& greater) : mGreater(greater), mData(NULL),
+    mLowest(0), mThreshold(0), mAugmented(false), mVertexCount(0), mNodeCount(0)
+{
+}
+
+int ThresholdSession::initialize(Neighborhood& neighborhood, FunctionType threshold,
+                                 bool augmented, const SweepOptions& options)
+{
+  SweepOptions sweep_options = options;
+
+  mData = gData;
+  mLowest = threshold;
+  mAugmented = augmented;
+  mLabels.resize(gDim[0]*gDim[1]*gDim[2]);
+
+  sweep_options.mOrder = &mOrder;
+
+  if (merge_tree_sorted_sweep((Comparison&)mGreater,neighborhood,threshold,mTree,augmented,
+                              &mLabels[0],sweep_options) == 0)
+    return 0;
+
+  mAncestors.build(mTree,mData,mGreater);
+
+  return this->threshold(threshold);
+}
+
+int ThresholdSession::update(Neighborhood& neighborhood, const GlobalIndexType low[3],
+                             const GlobalIndexType high[3], const FunctionType* previous)
+{
+  mData = gData;
+
+  if (merge_tree_update((Comparison&)mGreater,neighborhood,mLowest,low,high,previous,mTree,
+                        mAugmented,&mLabels[0],mOrder,&mUnionFind) == 0)
+    return 0;
+
+  mAncestors.build(mTree,mData,mGreater);
+
+  return this->threshold(mThreshold);
+}
+
+int ThresholdSession::threshold(FunctionType t)
+{
+  if (mGreater(mLowest,t)) {
+    fprintf(stderr,"Error, the threshold %f lies beyond the threshold %f of the session\n",t,mLowest);
+    return 0;
+  }
+
+  mThreshold = t;
+
+  // The vertices above t form a prefix of the sorted order
+  GlobalIndexType low = 0;
+  GlobalIndexType high = mOrder.size();
+  GlobalIndexType mid;
+
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (mGreater(mData[mOrder[mid]],t))
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  mVertexCount = low;
+
+  // and since the nodes are created in sorted order so do their nodes
+  LocalIndexType first = 0;
+  LocalIndexType last = mTree.size();
+  LocalIndexType middle;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (mGreater(mData[mTree.node(middle).index()],t))
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  mNodeCount = first;
+
+  return 1;
+}
+
+int ThresholdSession::restrictTree(MergeTree& tree) const
+{
+  tree.minimum(mTree.minimum());
+  tree.maximum(mTree.maximum());
+
+  for (LocalIndexType i=0;i<mNodeCount;i++) {
+    const Node& node = mTree.node(i);
+
+    tree.addCriticalPoint(node.index());
+    tree.node(i).rep(node.rep());
+
+    // Parents and siblings are higher and thus part of the prefix. Nodes
+    // whose descendant lies below the threshold become roots
+    tree.node(i).up(node.up());
+    if ((node.down() != LNULL) && (node.down() < mNodeCount)) {
+      tree.node(i).down(node.down());
+      tree.node(i).next(node.next());
+    }
+
+    if (mAugmented) {
+      const GlobalIndexType* vertices = mTree.arcBegin(i);
+      GlobalIndexType k = 1;
+
+      while ((k < mTree.arcSize(i)) && mGreater(mData[vertices[k]],mThreshold))
+        k++;
+
+      tree.arc(i).mVertices.insert(tree.arc(i).mVertices.end(),vertices + 1,vertices + k);
+    }
+  }
+
+  return 1;
+}
+
+int ThresholdSession::prepare(Metric& metric)
+{
+  if (!metric.explicitArcs()) {
+    metric.initialize(mData,&mTree);
+    return 1;
+  }
+
+  if (!mAugmented) {
+    fprintf(stderr,"Error, the metric needs a session with augmented arcs\n");
+    return 0;
+  }
+
+  mRestricted = MergeTree();
+  restrictTree(mRestricted);
+
+  metric.initialize(mData,&mRestricted);
+  metric.eval(mRestricted);
+
+  return 1;
+}
+
+void ThresholdSession::transform(const Metric& metric, GlobalIndexType begin, GlobalIndexType end,
+                                 FunctionType* output) const
+{
+  if (metric.explicitArcs()) {
+    FunctionType fill = metric.fillValue();
+
+#pragma omp parallel for schedule(static)
+    for (int64_t v=(int64_t)begin;v<(int64_t)end;v++) {
+      LocalIndexType l = label(v);
+      output[v - begin] = (l == LNULL) ? fill : mRestricted.node(l).metric();
+    }
+  }
+  else {
+#pragma omp parallel for schedule(static)
+    for (int64_t v=(int64_t)begin;v<(int64_t)end;v++)
+      output[v - begin] = metric.eval(v,label(v));
+  }
+}
+
+//! Order features by their representatives which are created in sorted order
+static bool feature_order(const SessionFeature& a, const SessionFeature& b)
+{
+  return a.rep < b.rep;
+}
+
+void ThresholdSession::features(std::vector<SessionFeature>& features) const
+{
+  std::vector<LocalIndexType> feature(mNodeCount);
+  SessionFeature f;
+
+  features.clear();
+
+  // Descendants are always created after their parents so the roots can
+  // be passed up in a single pass from the lowest node
+  for (LocalIndexType i=mNodeCount;i-- > 0;) {
+    LocalIndexType down = mTree.node(i).down();
+
+    if ((down == LNULL) || (down >= mNodeCount)) {
+      f.root = i;
+      f.rep = mTree.node(i).rep();
+      f.index = mTree.node(f.rep).index();
+      f.maximum = mData[f.index];
+      f.size = 0;
+
+      feature[i] = (LocalIndexType)features.size();
+      features.push_back(f);
+    }
+    else
+      feature[i] = feature[down];
+  }
+
+  int thread_count = 1;
+#ifdef _OPENMP
+  thread_count = omp_get_max_threads();
+#endif
+
+  // Count the vertices of the prefix per feature
+  std::vector<std::vector<GlobalIndexType> > local(thread_count);
+
+#pragma omp parallel
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    std::vector<GlobalIndexType>& count = local[t];
+    count.resize(features.size(),0);
+
+#pragma omp for schedule(static)
+    for (int64_t k=0;k<(int64_t)mVertexCount;k++)
+      count[feature[mLabels[mOrder[k]]]]++;
+  }
+
+  for (int t=0;t<thread_count;t++) {
+    for (LocalIndexType i=0;i<local[t].size();i++)
+      features[i].size += local[t][i];
+  }
+
+  std::sort(features.begin(),features.end(),feature_order);
+}
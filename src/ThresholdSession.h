@@ -0,0 +1,242 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#ifndef THRESHOLDSESSION_H
+#define THRESHOLDSESSION_H
+
+#include <vector>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "Neighborhood.h"
+#include "MergeTree.h"
+#include "MTAlgorithm.h"
+#include "Metric.h"
+#include "LevelAncestor.h"
+
+/*! A threshold session answers queries for any threshold at or above
+ *  the one it has been created for without sorting or sweeping again.
+ *  The sweep processes the vertices strictly in sorted order and a
+ *  vertex receives its final label when it is processed. The vertices
+ *  above a higher threshold form a prefix of the sorted order, the nodes
+ *  created for them a prefix of the nodes, and their labels and
+ *  representatives are exactly those a sweep at the higher threshold
+ *  would compute. Restricting to a threshold therefore only requires
+ *  cutting the tree below the prefix and ignoring the lower vertices.
+ */
+
+//! A connected component above the current threshold
+struct SessionFeature
+{
+  //! The lowest node of the component
+  LocalIndexType root;
+
+  //! The node of the highest vertex of the component
+  LocalIndexType rep;
+
+  //! The index of the highest vertex
+  GlobalIndexType index;
+
+  //! The function value of the highest vertex
+  FunctionType maximum;
+
+  //! The number of vertices of the component
+  GlobalIndexType size;
+};
+
+//! Compute a tree once and restrict it to different thresholds
+class ThresholdSession
+{
+public:
+
+  //! Constructor
+  /*!
+   * @param greater The comparison defining the tree type
+   */
+  ThresholdSession(const Comparison& greater);
+
+  //! Destructor
+  ~ThresholdSession() {}
+
+  //! Sweep the data at the lowest threshold of interest
+  /*!
+   * @param neighborhood The neighborhood of the vertices
+   * @param threshold The lowest (merge tree) or highest (split tree) threshold of interest
+   * @param augmented Whether the arcs should contain all vertices
+   * @param options The options of the sweep
+   * @return 1 if successful 0 otherwise
+   */
+  int initialize(Neighborhood& neighborhood, FunctionType threshold, bool augmented,
+                 const SweepOptions& options);
+
+  //! Bring the session up to date after the data of a box has changed
+  /*! The changed values must be stored in gData which replaces the data
+   *  of the session. The tree and labels are updated incrementally and
+   *  the current threshold is kept. Besides re-sweeping the vertices
+   *  below the change the cost is proportional to the box and the part
+   *  of the sorted order behind it (see merge_tree_update).
+   * @param neighborhood The neighborhood of the vertices
+   * @param low The first changed sample in each dimension
+   * @param high One past the last changed sample in each dimension
+   * @param previous The values of the box before the change (x fastest)
+   * @return 1 if successful 0 otherwise
+   */
+  int update(Neighborhood& neighborhood, const GlobalIndexType low[3], const GlobalIndexType high[3],
+             const FunctionType* previous);
+
+  //! Return the threshold the session has been created for
+  FunctionType lowestThreshold() const {return mLowest;}
+
+  //! Return the current threshold
+  FunctionType threshold() const {return mThreshold;}
+
+  //! Restrict the session to the given threshold
+  /*! @return 1 if successful and 0 if the threshold lies below the lowest one
+   */
+  int threshold(FunctionType t);
+
+  //! Return the number of vertices above the current threshold
+  GlobalIndexType vertexCount() const {return mVertexCount;}
+
+  //! Return the number of nodes above the current threshold
+  LocalIndexType nodeCount() const {return mNodeCount;}
+
+  //! Return the tree of the lowest threshold
+  const MergeTree& tree() const {return mTree;}
+
+  //! Return the label of vertex v at the current threshold
+  LocalIndexType label(GlobalIndexType v) const {
+    return ((mLabels[v] != LNULL) && mGreater(mData[v],mThreshold)) ? mLabels[v] : LNULL;
+  }
+
+  //! Return the lowest node of the feature containing vertex v at the current threshold
+  /*! The feature is found in O(log n) steps using the level ancestor index
+   *  and matches the root of the corresponding SessionFeature
+   */
+  LocalIndexType feature(GlobalIndexType v) const {return mAncestors.feature(label(v),mThreshold);}
+
+  //! Return the level ancestor index of the tree
+  const LevelAncestor& ancestors() const {return mAncestors;}
+
+  //! Copy the tree restricted to the current threshold into the (empty) given tree
+  int restrictTree(MergeTree& tree) const;
+
+  //! Initialize the metric for the current threshold
+  /*! Metrics that need explicit arcs are evaluated on the restricted tree
+   *  which requires an augmented session
+   * @return 1 if successful 0 otherwise
+   */
+  int prepare(Metric& metric);
+
+  //! Evaluate a prepared metric for the vertices [begin,end) in parallel
+  void transform(const Metric& metric, GlobalIndexType begin, GlobalIndexType end,
+                 FunctionType* output) const;
+
+  //! Compute the connected components above the current threshold
+  /*! The features are ordered by decreasing maximum
+   */
+  void features(std::vector<SessionFeature>& features) const;
+
+private:
+
+  //! The comparison defining the tree type
+  const Comparison& mGreater;
+
+  //! The data
+  const FunctionType* mData;
+
+  //! The threshold of the sweep
+  FunctionType mLowest;
+
+  //! The current threshold
+  FunctionType mThreshold;
+
+  //! Whether the arcs contain all vertices
+  bool mAugmented;
+
+  //! The tree of the lowest threshold
+  MergeTree mTree;
+
+  //! The labels of the lowest threshold
+  std::vector<LocalIndexType> mLabels;
+
+  //! The vertices above the lowest threshold in sorted order
+  std::vector<GlobalIndexType> mOrder;
+
+  //! The length of the prefix of mOrder above the current threshold
+  GlobalIndexType mVertexCount;
+
+  //! The number of nodes above the current threshold
+  LocalIndexType mNodeCount;
+
+  //! The level ancestor index of mTree
+  LevelAncestor mAncestors;
+
+  //! The restricted tree used by metrics with explicit arcs
+  MergeTree mRestricted;
+
+  //! The union-find structure of the sweep reused by updates
+  UnionFind mUnionFind;
+};
+
+
+#endif /* THRESHOLDSESSION_H_ */
@@ -0,0 +1,261 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TreeCache.h"
+
+//! The identifier at the beginning of a tree cache
+static const char gCacheMagic[4] = {'A','D','T','C'};
+
+TreeCache::TreeCache() : mMapping(NULL), mMappingSize(0), mLabels(NULL)
+{
+  memset(&mKey,0,sizeof(TreeCacheKey));
+}
+
+TreeCache::~TreeCache()
+{
+  if (mMapping != NULL)
+    munmap(mMapping,mMappingSize);
+}
+
+int TreeCache::key(const char* filename, const GlobalIndexType dim[3], const GlobalIndexType region[3],
+                   DataType type, bool swap, const InputLayout& layout, FunctionType threshold,
+                   int tree_type, uint32_t connectivity)
+{
+  struct stat info;
+  char path[PATH_MAX];
+
+  memset(&mKey,0,sizeof(TreeCacheKey));
+
+  if ((realpath(filename,path) == NULL) || (stat(path,&info) != 0) || !S_ISREG(info.st_mode)) {
+    fprintf(stderr,"Error, the tree cache needs a regular input file\n");
+    return 0;
+  }
+
+  // A truncated path could match the key of a different file
+  size_t length = strlen(path);
+  if (length >= sizeof(mKey.path)) {
+    fprintf(stderr,"Error, the input path is too long for the tree cache\n");
+    return 0;
+  }
+
+  memcpy(mKey.path,path,length);
+  mKey.fileSize = info.st_size;
+  mKey.mtime[0] = info.st_mtim.tv_sec;
+  mKey.mtime[1] = info.st_mtim.tv_nsec;
+  mKey.offset = layout.mOffset;
+
+  for (int i=0;i<3;i++) {
+    mKey.dim[i] = (uint32_t)dim[i];
+    mKey.regionOffset[i] = (uint32_t)region[i];
+  }
+
+  mKey.dataType = type;
+  mKey.swap = swap ? 1 : 0;
+  mKey.stride = layout.mStride;
+  mKey.component = layout.mComponent;
+  mKey.threshold = threshold;
+  mKey.treeType = tree_type;
+  mKey.connectivity = connectivity;
+
+  return 1;
+}
+
+int TreeCache::load(const char* filename, bool augmented, MergeTree& tree)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  struct stat info;
+
+  int fd = open(filename,O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  if ((fstat(fd,&info) != 0) || ((size_t)info.st_size < sizeof(TreeCacheHeader))) {
+    close(fd);
+    return 0;
+  }
+
+  void* mapping = mmap(NULL,info.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+
+  if (mapping == MAP_FAILED)
+    return 0;
+
+  const TreeCacheHeader* header = (const TreeCacheHeader*)mapping;
+  const char* reason = NULL;
+
+  if ((memcmp(header->magic,gCacheMagic,4) != 0) || (header->version != 1))
+    reason = "not a tree cache";
+  else if (memcmp(&header->key,&mKey,sizeof(TreeCacheKey)) != 0)
+    reason = "computed for a different input or parameters";
+  else if (augmented && !header->augmented)
+    reason = "missing the augmented arcs";
+  else if ((size_t)info.st_size != sizeof(TreeCacheHeader) + header->nodeCount*sizeof(TreeCacheNode)
+           + (header->nodeCount + 1 + header->vertexCount)*sizeof(uint64_t)
+           + header->labelCount*sizeof(LocalIndexType))
+    reason = "truncated";
+  else if (header->labelCount != (uint64_t)mKey.dim[0]*mKey.dim[1]*mKey.dim[2])
+    reason = "of the wrong size";
+
+  if (reason != NULL) {
+    fprintf(stderr,"Ignoring the tree cache \"%s\" which is %s\n",filename,reason);
+    munmap(mapping,info.st_size);
+    return 0;
+  }
+
+  const TreeCacheNode* nodes = (const TreeCacheNode*)(header + 1);
+  const uint64_t* offsets = (const uint64_t*)(nodes + header->nodeCount);
+  const uint64_t* vertices = offsets + header->nodeCount + 1;
+
+  for (uint32_t i=0;i<header->nodeCount;i++) {
+    tree.addCriticalPoint(nodes[i].index);
+    tree.node(i).down(nodes[i].down);
+    tree.node(i).up(nodes[i].up);
+    tree.node(i).next(nodes[i].next);
+    tree.node(i).rep(nodes[i].rep);
+
+    // Unaugmented arcs only contain their head
+    if (augmented)
+      tree.arc(i).mVertices.assign(vertices + offsets[i],vertices + offsets[i+1]);
+  }
+
+  tree.minimum(header->minimum);
+  tree.maximum(header->maximum);
+
+  mMapping = mapping;
+  mMappingSize = info.st_size;
+  mLabels = (const LocalIndexType*)(vertices + header->vertexCount);
+
+  fprintf(stderr,"Loaded %u nodes from the tree cache in %.3f s\n",header->nodeCount,
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  return 1;
+}
+
+int TreeCache::save(const char* filename, bool augmented, const MergeTree& tree,
+                    const LocalIndexType* labels, GlobalIndexType count) const
+{
+  TreeCacheHeader header;
+  std::vector<TreeCacheNode> nodes(tree.size());
+  std::vector<uint64_t> offsets(tree.size() + 1,0);
+
+  memset(&header,0,sizeof(TreeCacheHeader));
+  memcpy(header.magic,gCacheMagic,4);
+  header.version = 1;
+  header.key = mKey;
+  header.augmented = augmented ? 1 : 0;
+  header.nodeCount = tree.size();
+  header.labelCount = count;
+  header.minimum = tree.minimum();
+  header.maximum = tree.maximum();
+
+  for (LocalIndexType i=0;i<tree.size();i++) {
+    nodes[i].index = tree.node(i).index();
+    nodes[i].down = tree.node(i).down();
+    nodes[i].up = tree.node(i).up();
+    nodes[i].next = tree.node(i).next();
+    nodes[i].rep = tree.node(i).rep();
+    offsets[i+1] = offsets[i] + tree.arcSize(i);
+  }
+  header.vertexCount = offsets.back();
+
+  // Write into a temporary file first so an interrupted run never leaves
+  // a damaged cache behind
+  std::string temporary = std::string(filename) + ".tmp";
+  FILE* output = fopen(temporary.c_str(),"wb");
+  if (output == NULL) {
+    fprintf(stderr,"Error, could not open tree cache \"%s\"\n",temporary.c_str());
+    return 0;
+  }
+
+  bool success = (fwrite(&header,sizeof(TreeCacheHeader),1,output) == 1)
+                 && (fwrite(nodes.data(),sizeof(TreeCacheNode),nodes.size(),output) == nodes.size())
+                 && (fwrite(offsets.data(),sizeof(uint64_t),offsets.size(),output) == offsets.size());
+
+  for (LocalIndexType i=0;success && (i<tree.size());i++) {
+    success = (fwrite(tree.arcBegin(i),sizeof(GlobalIndexType),tree.arcSize(i),output) == tree.arcSize(i));
+  }
+
+  success = success && (fwrite(labels,sizeof(LocalIndexType),count,output) == count);
+
+  if ((fclose(output) != 0) || !success || (rename(temporary.c_str(),filename) != 0)) {
+    fprintf(stderr,"Error, could not write tree cache \"%s\"\n",filename);
+    unlink(temporary.c_str());
+    return 0;
+  }
+
+  fprintf(stderr,"Saved %u nodes to the tree cache \"%s\"\n",header.nodeCount,filename);
+
+  return 1;
+}
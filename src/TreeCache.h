@@ -0,0 +1,240 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef TREECACHE_H
+#define TREECACHE_H
+
+#include <stdint.h>
+
+#include "Definitions.h"
+#include "DataType.h"
+#include "MergeTree.h"
+#include "InputVolume.h"
+
+/*! A tree cache stores the result of the sweep, i.e. the unsplit merge
+ *  tree and the labels volume, so that other metrics or splits can be
+ *  evaluated without screening, sorting and sweeping again. The file
+ *  consists of a TreeCacheHeader, one TreeCacheNode per node, the uint64
+ *  arc offsets (node count + 1, in CSR form), the uint64 arc vertices
+ *  and the labels volume. All sections are 8 byte aligned so the file
+ *  can be mapped and the labels used in place.
+ */
+
+//! Everything that determines the result of the sweep
+struct TreeCacheKey
+{
+  //! The absolute path of the input file
+  char path[256];
+
+  //! The size of the input file in bytes
+  uint64_t fileSize;
+
+  //! The modification time of the input file
+  int64_t mtime[2];
+
+  //! The byte offset of the values within the input file
+  uint64_t offset;
+
+  //! The dimensions of the processed volume
+  uint32_t dim[3];
+
+  //! The lower corner of the processed region within the file
+  uint32_t regionOffset[3];
+
+  //! The data type of the input
+  uint32_t dataType;
+
+  //! Whether the input was byte swapped
+  uint32_t swap;
+
+  //! The number of values per voxel
+  uint32_t stride;
+
+  //! The component used
+  uint32_t component;
+
+  //! The threshold
+  float threshold;
+
+  //! The tree type (0 merge, 1 split)
+  int32_t treeType;
+
+  //! The number of neighbors of a vertex
+  uint32_t connectivity;
+
+  //! Padding to a multiple of 8 bytes
+  uint32_t reserved;
+};
+
+//! The fixed size header of a tree cache
+struct TreeCacheHeader
+{
+  //! The characters "ADTC"
+  char magic[4];
+
+  //! The version of the format
+  uint32_t version;
+
+  //! The key the cache has been computed for
+  TreeCacheKey key;
+
+  //! Whether the arcs store all their vertices
+  uint32_t augmented;
+
+  //! The number of nodes
+  uint32_t nodeCount;
+
+  //! The total number of arc vertices
+  uint64_t vertexCount;
+
+  //! The number of labels
+  uint64_t labelCount;
+
+  //! The minimum of the tree
+  float minimum;
+
+  //! The maximum of the tree
+  float maximum;
+};
+
+//! A node of a tree cache
+struct TreeCacheNode
+{
+  //! The index of the vertex
+  uint64_t index;
+
+  //! The descendant
+  uint32_t down;
+
+  //! One parent
+  uint32_t up;
+
+  //! The next sibling
+  uint32_t next;
+
+  //! The representative
+  uint32_t rep;
+};
+
+//! Save and restore the result of a sweep
+class TreeCache
+{
+public:
+
+  //! Default constructor
+  TreeCache();
+
+  //! Destructor releasing the mapping
+  ~TreeCache();
+
+  //! Compute the key for the given input and parameters
+  /*!
+   * @param filename The name of the input file
+   * @param dim The dimensions of the processed volume
+   * @param region The lower corner of the processed region within the file
+   * @param type The type of the input values
+   * @param swap Whether the input is byte swapped
+   * @param layout The location of the values within the file
+   * @param threshold The threshold of the sweep
+   * @param tree_type The tree type (0 merge, 1 split)
+   * @param connectivity The number of neighbors of a vertex
+   * @return 1 if successful 0 otherwise
+   */
+  int key(const char* filename, const GlobalIndexType dim[3], const GlobalIndexType region[3],
+          DataType type, bool swap, const InputLayout& layout, FunctionType threshold,
+          int tree_type, uint32_t connectivity);
+
+  //! Load the tree and map the labels if the cache matches the key
+  /*! A cache of an augmented tree can be used for either kind of tree,
+   *  a cache of an unaugmented tree only if no augmentation is needed.
+   * @param filename The name of the cache file
+   * @param augmented Whether the arcs must contain all vertices
+   * @param tree The (empty) tree to restore
+   * @return 1 if the cache has been loaded and 0 if it is missing or stale
+   */
+  int load(const char* filename, bool augmented, MergeTree& tree);
+
+  //! Return the labels of a loaded cache
+  const LocalIndexType* labels() const {return mLabels;}
+
+  //! Write the given tree and labels using the current key
+  int save(const char* filename, bool augmented, const MergeTree& tree,
+           const LocalIndexType* labels, GlobalIndexType count) const;
+
+private:
+
+  //! The key of the current computation
+  TreeCacheKey mKey;
+
+  //! The mapping of a loaded cache
+  void* mMapping;
+
+  //! The size of the mapping
+  size_t mMappingSize;
+
+  //! The labels within the mapping
+  const LocalIndexType* mLabels;
+};
+
+
+#endif /* TREECACHE_H_ */
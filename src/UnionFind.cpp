@@ -67,7 +67,7 @@
 LocalIndexType UnionFind::rep(LocalIndexType id)
 {
    LocalIndexType local;
-   static std::vector<LocalIndexType> s;
+   std::vector<LocalIndexType>& s = mPath;
 
   //! Sanity check to make sure we ask only for existing labels
   assert(mIndexMap.find(id) != mIndexMap.end());
@@ -121,6 +121,13 @@ void UnionFind::addLabel(LocalIndexType label)
   mIndexMap[label] = (LocalIndexType)(mLabel.size()-1);
 }
 
+void UnionFind::clear()
+{
+  mLabel.clear();
+  mIndexMap.clear();
+  mPath.clear();
+}
+
 void UnionFind::mergeLabel(LocalIndexType from, LocalIndexType to)
 {
   assert(mIndexMap.find(from) != mIndexMap.end());
@@ -96,6 +96,9 @@ public:
   //! Combine the "from" label with the "to" label
   void mergeLabel(LocalIndexType from, LocalIndexType to);
 
+  //! Remove all labels but keep the allocated storage
+  void clear();
+
 private:
 
   //! The current representative of the i'th label
@@ -103,6 +106,9 @@ private:
 
   //! An index map to convert global label-indices into local mLabel indices
   std::unordered_map<LocalIndexType,LocalIndexType> mIndexMap;
+
+  //! Scratch space for the path compression of rep()
+  std::vector<LocalIndexType> mPath;
 };
 
 
@@ -0,0 +1,137 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#ifndef VOLUMEOUTPUT_H
+#define VOLUMEOUTPUT_H
+
+#include <vector>
+
+#include "Definitions.h"
+#include "AsyncWriter.h"
+#include "Quantizer.h"
+
+//! The baseclass of all output formats of transformed volumes
+/*! Volumes are passed plane by plane in increasing z order together with
+ *  the corresponding labels. The data is written asynchronously by the
+ *  AsyncWriter owned by the output.
+ */
+class VolumeOutput
+{
+public:
+
+  //! Default constructor
+  VolumeOutput() {}
+
+  //! Destructor
+  virtual ~VolumeOutput() {}
+
+  //! Open the given file or stdout if filename is NULL
+  virtual int open(const char* filename, bool direct=false) {return mOutput.open(filename,direct);}
+
+  //! Add the next plane of values and their labels
+  virtual int writePlane(const FunctionType* plane, const LocalIndexType* labels) = 0;
+
+  //! Finish the format and close the file
+  virtual int close() {return mOutput.close();}
+
+protected:
+
+  //! The output stream
+  AsyncWriter mOutput;
+};
+
+//! A headerless raw volume of floats or a quantized volume
+class RawOutput : public VolumeOutput
+{
+public:
+
+  //! Constructor
+  /*!
+   * @param dim The dimensions of the volume
+   * @param quantizer The quantizer to encode values with or NULL to store floats
+   */
+  RawOutput(const GlobalIndexType dim[3], const Quantizer* quantizer);
+
+  //! Destructor
+  virtual ~RawOutput() {}
+
+  //! Open the file and write the quantization header if necessary
+  virtual int open(const char* filename, bool direct=false);
+
+  //! Add the next plane of values
+  virtual int writePlane(const FunctionType* plane, const LocalIndexType* labels);
+
+private:
+
+  //! The dimensions of the volume
+  GlobalIndexType mDim[3];
+
+  //! The quantization if any
+  Quantizer mQuantizer;
+
+  //! Buffer for a quantized plane
+  std::vector<char> mQuantized;
+};
+
+
+#endif /* VOLUMEOUTPUT_H_ */
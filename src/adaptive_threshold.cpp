@@ -61,9 +61,12 @@
 * purposes.
 ********************************************************************************/
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 
 #include "Definitions.h"
@@ -71,12 +74,24 @@
 #include "FullNeighborhood.h"
 #include "MergeTree.h"
 #include "MTAlgorithm.h"
+#include "InputVolume.h"
+#include "TreeCache.h"
+#include "AsyncWriter.h"
+#include "Quantizer.h"
+#include "VolumeOutput.h"
+#include "BrickedVolume.h"
+#include "SparseVolume.h"
 #include "Relevance.h"
 #include "R2.h"
+#include "Threshold.h"
+#include "LocalThreshold.h"
+#include "FeatureAttributes.h"
+#include "PersistenceDiagram.h"
+#include "SegmentationHierarchy.h"
 #include "ManPage.h"
 
 //!Number of available input options (size of gOptions)
-#define NUM_OPTIONS 9
+#define NUM_OPTIONS 31
 
 //!Array with the list of all available input options
 static const char* gOptions[NUM_OPTIONS] = {
@@ -92,19 +107,124 @@ static const char* gOptions[NUM_OPTIONS] = {
     "--split-type",
     "--split",
     "--metric",
+    "--attributes",
+    "--no-mmap",
+    "--dtype",
+    "--swap-bytes",
+    "--sort",
+    "--direct-io",
+    "--quantize",
+    "--format",
+    "--brick-size",
+    "--roi",
+    "--roi-output",
+    "--offset",
+    "--stride",
+    "--component",
+    "--summary-size",
+    "--tree-cache",
+    "--simplify",
+    "--simplify-size",
+    "--hierarchy",
+    "--persistence",
+    "--betti",
+    "--threshold-quantile",
 };
 
 //! Name of the input file
 const char* gInputFileName = NULL;
 
+//! Name of the optional tree cache
+const char* gTreeCacheName = NULL;
+
 //! Name of the output file
 const char* gOutputFileName = NULL;
 
-//! Global array of data (will be allocated to gDim[0]*gDim[1]*gDim[2]
-FunctionType* gData = NULL;
+//! Whether the output should bypass the page cache
+bool gDirectIO = false;
+
+//! Number of bits of the quantized output or 0 for floats
+uint32_t gQuantizeBits = 0;
+
+//! Number of output formats
+#define NUM_FORMAT_TYPES 3
+//! List of available output formats
+static const char* gFormatTypeOptions[NUM_FORMAT_TYPES] = {
+    "raw",
+    "bricked",
+    "sparse",
+};
+//! Enum of output formats
+enum FormatType {
+  FORMAT_RAW = 0,
+  FORMAT_BRICKED = 1,
+  FORMAT_SPARSE = 2,
+};
+//! The output format
+FormatType gFormat = FORMAT_RAW;
+
+//! The edge length of bricks in bricked output
+uint32_t gBrickSize = 64;
+
+//! Name of the optional segmentation hierarchy file
+const char* gHierarchyFileName = NULL;
+
+//! Name of the optional feature attribute file
+const char* gAttributeFileName = NULL;
+
+//! Global array of data (will point to gDim[0]*gDim[1]*gDim[2] values)
+thread_local const FunctionType* gData = NULL;
+
+//! Whether the input file should be memory mapped
+bool gUseMMap = true;
+
+//! The type of the values stored in the input file
+DataType gDataType = DATA_FLOAT32;
+
+//! Whether the byte order of the input file differs from the host
+bool gSwapBytes = false;
+
+//! The location of the values within the input file
+InputLayout gLayout;
+
+//! The brick size of the min/max summary used to skip empty space (0 to disable)
+uint32_t gSummarySize = 16;
+
+//! Number of sort types
+#define NUM_SORT_TYPES 3
+//! List of available sort types
+static const char* gSortTypeOptions[NUM_SORT_TYPES] = {
+    "auto",
+    "generic",
+    "counting",
+};
+//! The sort used to order the vertices
+SortType gSortType = SORT_AUTO;
 
 //! Global array of dimensions
-GlobalIndexType gDim[3] = {0,0,0};
+thread_local GlobalIndexType gDim[3] = {0,0,0};
+
+//! Dimensions of the full volume stored in the input file
+GlobalIndexType gFullDim[3] = {0,0,0};
+
+//! The lower corner of the region of interest
+GlobalIndexType gROILow[3] = {0,0,0};
+
+//! The upper corner (exclusive) of the region of interest
+GlobalIndexType gROIHigh[3] = {0,0,0};
+
+//! Bool to indicate whether a region of interest has been set
+bool gROISet = false;
+
+//! Number of region of interest output modes
+#define NUM_ROI_OUTPUT_TYPES 2
+//! List of available region of interest output modes
+static const char* gROIOutputOptions[NUM_ROI_OUTPUT_TYPES] = {
+    "crop",
+    "full",
+};
+//! Whether the region of interest is embedded into a full size output
+bool gROIFullOutput = false;
 
 //! Tree type 0 (merge tree), 1 (split tree)
 int gTreeType = 0;
@@ -115,6 +235,9 @@ FunctionType gThreshold = 0;
 //! Bool to indicate whether the threshold has been set
 bool gThresholdSet = false;
 
+//! Fraction of the vertices to keep or a negative value to use gThreshold
+double gThresholdQuantile = -1;
+
 //! Number of different split types
 #define NUM_SPLIT_TYPES 2
 //! List of available split types
@@ -134,20 +257,87 @@ SplitType gSplitType = SPLIT_LENGTH;
 //! The splitting threshold
 FunctionType gSplitLimit = -1;
 
+//! Name of the optional persistence diagram file
+const char* gPersistenceFileName = NULL;
+
+//! Name of the optional component count curve file
+const char* gBettiFileName = NULL;
+
+//! Cancel branches whose persistence is smaller than this (0 to disable)
+FunctionType gSimplifyPersistence = 0;
+
+//! Cancel branches with fewer vertices than this (0 to disable)
+GlobalIndexType gSimplifySize = 0;
+
 //! Number of metrics
-#define NUM_METRIC_TYPES 2
+#define NUM_METRIC_TYPES 4
 //! List of available metrics
 static const char* gMetricTypeOptions[NUM_METRIC_TYPES] = {
     "relevance",
     "R2",
+    "threshold",
+    "local",
 };
 //! Enum of metrics
 enum MetricType {
   METRIC_RELEVANCE = 0,
   METRIC_R2 = 1,
+  METRIC_THRESHOLD = 2,
+  METRIC_LOCAL = 3,
 };
-//! The metric used
-MetricType gMetric = METRIC_RELEVANCE;
+//! The metrics computed (one output each)
+std::vector<MetricType> gMetrics;
+
+/*! \brief Parse a comma separated list of metric names
+ *
+ * \param list : The list of names
+ * \param metrics : The vector the metrics are appended to
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_metric_list(const char* list, std::vector<MetricType>& metrics)
+{
+  std::string names(list);
+  size_t start = 0;
+  int j;
+
+  while (start <= names.size()) {
+    size_t end = std::min(names.find(',',start),names.size());
+    std::string name = names.substr(start,end - start);
+
+    for (j=0; j < NUM_METRIC_TYPES;j++) {
+      if (name == gMetricTypeOptions[j]) {
+        if (std::find(metrics.begin(),metrics.end(),(MetricType)j) == metrics.end())
+          metrics.push_back((MetricType)j);
+        break;
+      }
+    }
+    if (j == NUM_METRIC_TYPES) {
+      fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",name.c_str());
+      return 0;
+    }
+
+    start = end + 1;
+  }
+
+  return 1;
+}
+
+//! Create the given metric
+Metric* create_metric(MetricType type)
+{
+  switch (type) {
+    case METRIC_RELEVANCE:
+      return new Relevance();
+    case METRIC_R2:
+      return new R2();
+    case METRIC_THRESHOLD:
+      return new Threshold();
+    case METRIC_LOCAL:
+      return new LocalThreshold();
+  }
+
+  return NULL;
+}
 
 /*! \brief Parse the command line input.
  *
@@ -213,15 +403,126 @@ int parse_command_line(int argc, const char** argv)
       gSplitLimit = (FunctionType)atof(argv[++i]);
       break;
     case 8: // --metric
+      if (parse_metric_list(argv[++i],gMetrics) == 0)
+        return 0;
+      break;
+    case 9: // --attributes
+      gAttributeFileName = argv[++i];
+      break;
+    case 10: // --no-mmap
+      gUseMMap = false;
+      break;
+    case 11: // --dtype
+      i++;
+      if (parse_data_type(argv[i],gDataType) == 0) {
+        fprintf(stderr,"Sorry, the data type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 12: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 13: // --sort
+      i++;
+      for (j=0; j < NUM_SORT_TYPES;j++) {
+        if(strcmp(gSortTypeOptions[j],argv[i])==0) {
+          gSortType = (SortType)j;
+          break;
+        }
+      }
+      if (j == NUM_SORT_TYPES) {
+        fprintf(stderr,"Sorry, the sort type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 14: // --direct-io
+      gDirectIO = true;
+      break;
+    case 15: // --quantize
+      gQuantizeBits = atoi(argv[++i]);
+      if ((gQuantizeBits != 8) && (gQuantizeBits != 16)) {
+        fprintf(stderr,"Sorry, only 8 or 16 bit quantization is supported .....\n");
+        return 0;
+      }
+      break;
+    case 16: // --format
+      i++;
+      for (j=0; j < NUM_FORMAT_TYPES;j++) {
+        if(strcmp(gFormatTypeOptions[j],argv[i])==0) {
+          gFormat = (FormatType)j;
+          break;
+        }
+      }
+      if (j == NUM_FORMAT_TYPES) {
+        fprintf(stderr,"Sorry, the output format \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 17: // --brick-size
+      gBrickSize = atoi(argv[++i]);
+      if (gBrickSize == 0) {
+        fprintf(stderr,"Sorry, the brick size must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 18: // --roi
+      for (j=0;j<3;j++)
+        gROILow[j] = atoi(argv[++i]);
+      for (j=0;j<3;j++)
+        gROIHigh[j] = atoi(argv[++i]);
+      gROISet = true;
+      break;
+    case 19: // --roi-output
       i++;
-      for (j=0; j < NUM_METRIC_TYPES;j++) {
-        if(strcmp(gMetricTypeOptions[j],argv[i])==0) {
-          gMetric = (MetricType)j;
+      for (j=0; j < NUM_ROI_OUTPUT_TYPES;j++) {
+        if(strcmp(gROIOutputOptions[j],argv[i])==0) {
+          gROIFullOutput = (j == 1);
           break;
         }
       }
-      if (j == NUM_METRIC_TYPES) {
-        fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",argv[i]);
+      if (j == NUM_ROI_OUTPUT_TYPES) {
+        fprintf(stderr,"Sorry, the region output \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 20: // --offset
+      gLayout.mOffset = strtoull(argv[++i],NULL,10);
+      break;
+    case 21: // --stride
+      gLayout.mStride = atoi(argv[++i]);
+      if (gLayout.mStride == 0) {
+        fprintf(stderr,"Sorry, the stride must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 22: // --component
+      gLayout.mComponent = atoi(argv[++i]);
+      break;
+    case 23: // --summary-size
+      gSummarySize = atoi(argv[++i]);
+      break;
+    case 24: // --tree-cache
+      gTreeCacheName = argv[++i];
+      break;
+    case 25: // --simplify
+      gSimplifyPersistence = (FunctionType)atof(argv[++i]);
+      break;
+    case 26: // --simplify-size
+      gSimplifySize = strtoull(argv[++i],NULL,10);
+      break;
+    case 27: // --hierarchy
+      gHierarchyFileName = argv[++i];
+      break;
+    case 28: // --persistence
+      gPersistenceFileName = argv[++i];
+      break;
+    case 29: // --betti
+      gBettiFileName = argv[++i];
+      break;
+    case 30: // --threshold-quantile
+      gThresholdQuantile = atof(argv[++i]);
+      if ((gThresholdQuantile < 0) || (gThresholdQuantile > 1)) {
+        fprintf(stderr,"Sorry, the quantile must lie in [0,1] .....\n");
         return 0;
       }
       break;
@@ -241,49 +542,188 @@ int main(int argc, const char** argv)
     return 0;
   }
 
-  GlobalIndexType size = gDim[0]*gDim[1]*gDim[2];
+  if (gInputFileName == NULL) {
+    fprintf(stderr,"Error, no input filename given\n");
+    return 0;
+  }
 
+  // The comparison defining the tree type
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+
+  // Map (or read) the input data
+  InputVolume input;
+  BrickIndex bricks;
+  bool bricked = is_bricked_volume(gInputFileName);
+
+  // Bricked input describes itself and only bricks that may contain
+  // vertices above the threshold are read
+  if (bricked) {
+    if (gROISet) {
+      fprintf(stderr,"Error, a region of interest is not supported for bricked input\n");
+      return 0;
+    }
 
-  Metric* metric = NULL;
-  if (gMetric == METRIC_RELEVANCE) {
-    metric = new Relevance();
+    if (gThresholdQuantile >= 0) {
+      fprintf(stderr,"Error, a quantile threshold is not supported for bricked input\n");
+      return 0;
+    }
+
+    if (input.readBricked(gInputFileName,greater,gThreshold,gDim,bricks,gDataType) == 0)
+      return 0;
   }
-  else if (gMetric == METRIC_R2) {
-    metric = new R2();
+
+  // From here on gDim refers to the region that is processed and
+  // gFullDim to the volume stored in the file
+  gFullDim[0] = gDim[0];
+  gFullDim[1] = gDim[1];
+  gFullDim[2] = gDim[2];
+
+  if (gROISet) {
+    for (int i=0;i<3;i++) {
+      if ((gROILow[i] >= gROIHigh[i]) || (gROIHigh[i] > gFullDim[i])) {
+        fprintf(stderr,"Error, the region of interest must be non-empty and inside the volume\n");
+        return 0;
+      }
+      gDim[i] = gROIHigh[i] - gROILow[i];
+    }
   }
+  else
+    gROIFullOutput = false;
 
+  if (!bricked) {
+    if (gROISet) {
+      if (input.readRegion(gInputFileName,gFullDim,gROILow,gROIHigh,gDataType,gSwapBytes,gLayout) == 0)
+        return 0;
+    }
+    else if (input.read(gInputFileName,gDim,gDataType,gSwapBytes,gUseMMap,gLayout) == 0)
+      return 0;
+  }
 
-  gData = new FunctionType[size];
-  FunctionType* transform = new FunctionType[gDim[0]*gDim[1]];
-  LocalIndexType* labels = new LocalIndexType[size];
+  gData = input.data();
 
-  FILE* input = NULL;
-  if (gInputFileName != NULL)
-    input = fopen(gInputFileName,"rb");
-  else {
-    fprintf(stderr,"Error, no input filename given\n");
-    return 0;
+  // The histogram that finds the cutoff also counts the vertices above it
+  GlobalIndexType expected = 0;
+
+  if (gThresholdQuantile >= 0) {
+    gThreshold = quantile_threshold(gData,gDim[0]*gDim[1]*gDim[2],greater,gThresholdQuantile,expected);
+
+    fprintf(stderr,"Using threshold %g keeping %llu vertices (quantile %g)\n",gThreshold,
+            (unsigned long long)expected,gThresholdQuantile);
   }
 
+  // Summarize the data so that empty space can be skipped for any threshold
+  if (!bricked && (gSummarySize > 0))
+    bricks.build(gData,gDim,gSummarySize);
+
+  GlobalIndexType size = gDim[0]*gDim[1]*gDim[2];
+
+
+  if (gMetrics.empty())
+    gMetrics.push_back(METRIC_RELEVANCE);
+
+  if ((gMetrics.size() > 1) && (gOutputFileName == NULL)) {
+    fprintf(stderr,"Error, several metrics need an output filename\n");
+    return 0;
+  }
 
-  // Some systems do not gracefully handle very large files so we read
-  // things by plane instead
-  for (int i=0;i<gDim[2];i++)
-    fread(gData+i*gDim[0]*gDim[1],sizeof(FunctionType),gDim[0]*gDim[1],input);
-  fclose(input);
+  // The tree needs augmented arcs if any of the metrics does
+  std::vector<Metric*> metrics(gMetrics.size());
+  bool augmented = false;
 
+  for (uint32_t m=0;m<metrics.size();m++) {
+    metrics[m] = create_metric(gMetrics[m]);
+    augmented = augmented || metrics[m]->explicitArcs();
+  }
 
   MergeTree tree;
   FullNeighborhood neighborhood(gDim);
-  bool augmented = metric->explicitArcs();
 
-  if (gTreeType == 0) {
-    MergeTreeComp comp;
-    merge_tree_sorted_sweep(comp,neighborhood,gThreshold,tree,augmented,labels);
-  }
+  SweepOptions options;
+  options.mDomain = data_type_domain(gDataType);
+  options.mSort = gSortType;
+  options.mBricks = bricks.empty() ? NULL : &bricks;
+  options.mReserve = expected;
+
+  // Restore the tree and labels from the cache if possible and otherwise
+  // sweep and fill the cache for the next run
+  TreeCache cache;
+  LocalIndexType* label_buffer = NULL;
+  const LocalIndexType* labels = NULL;
+
+  if ((gTreeCacheName != NULL)
+      && (cache.key(gInputFileName,gDim,gROILow,gDataType,gSwapBytes,gLayout,gThreshold,gTreeType,
+                    neighborhood.size()) == 0))
+    return 0;
+
+  if ((gTreeCacheName != NULL) && (cache.load(gTreeCacheName,augmented,tree) == 1))
+    labels = cache.labels();
   else {
-    SplitTreeComp comp;
-    merge_tree_sorted_sweep(comp,neighborhood,gThreshold,tree,augmented,labels);
+    label_buffer = new LocalIndexType[size];
+    labels = label_buffer;
+
+    merge_tree_sorted_sweep(greater,neighborhood,gThreshold,tree,augmented,label_buffer,options);
+
+    if (gTreeCacheName != NULL)
+      cache.save(gTreeCacheName,augmented,tree,labels,size);
+  }
+
+  // Cancel the noise branches before splitting and evaluating any metric
+  if ((gSimplifyPersistence > 0) || (gSimplifySize > 0)) {
+    std::vector<GlobalIndexType> sizes;
+    std::vector<LocalIndexType> map;
+    LocalIndexType nodes = tree.size();
+
+    if (gSimplifySize > 0)
+      count_labels(labels,size,tree.size(),sizes);
+
+    tree.simplify(greater,gSimplifyPersistence,gSimplifySize,sizes,map);
+
+    // Labels restored from the cache are read-only
+    if (label_buffer == NULL) {
+      label_buffer = new LocalIndexType[size];
+      std::copy(labels,labels + size,label_buffer);
+      labels = label_buffer;
+    }
+
+    // The vertices of cancelled leaves are spread over the arcs of their
+    // branch, which only the augmented arcs record
+    if (augmented) {
+      for (LocalIndexType i=0;i<tree.size();i++) {
+        for (GlobalIndexType k=0;k<tree.arcSize(i);k++)
+          label_buffer[tree.arcBegin(i)[k]] = i;
+      }
+    }
+    else
+      relabel_vertices(label_buffer,size,map);
+
+    fprintf(stderr,"Simplified the tree from %u to %u nodes\n",nodes,tree.size());
+  }
+
+  // Export the persistence diagram and component counts of the tree
+  if ((gPersistenceFileName != NULL) || (gBettiFileName != NULL)) {
+    PersistenceDiagram diagram;
+    const char* names[2] = {gPersistenceFileName,gBettiFileName};
+
+    diagram.compute(tree,gData,greater,gThreshold);
+
+    for (int k=0;k<2;k++) {
+      if (names[k] == NULL)
+        continue;
+
+      FILE* output = fopen(names[k],"w");
+      if (output == NULL) {
+        fprintf(stderr,"Error, could not open \"%s\"\n",names[k]);
+        return 0;
+      }
+
+      if (k == 0)
+        diagram.writePairs(output);
+      else
+        diagram.writeCurve(output);
+      fclose(output);
+    }
   }
 
   // Now we potentially want to split the tree
@@ -300,59 +740,251 @@ int main(int argc, const char** argv)
   }
 
 
-  metric->initialize(gData,&tree);
+  // Metrics that need augmented arcs are evaluated per node and their
+  // node values stored since the tree only holds one metric at a time
+  std::vector<std::vector<FunctionType> > node_values(metrics.size());
+
+  for (uint32_t m=0;m<metrics.size();m++) {
+    metrics[m]->initialize(gData,&tree);
+
+    if (metrics[m]->explicitArcs()) {
+      metrics[m]->eval(tree);
+
+      node_values[m].resize(tree.size());
+      for (LocalIndexType i=0;i<tree.size();i++)
+        node_values[m][i] = tree.node(i).metric();
+    }
+  }
+
+  // Encode the segmentation of all metric levels if requested
+  if (gHierarchyFileName != NULL) {
+
+    // Splitting moves vertices into new arcs so their labels are updated
+    if (gSplitLimit > 0) {
+      if (label_buffer == NULL) {
+        label_buffer = new LocalIndexType[size];
+        std::copy(labels,labels + size,label_buffer);
+        labels = label_buffer;
+      }
+
+      for (LocalIndexType i=0;i<tree.size();i++) {
+        for (GlobalIndexType k=0;k<tree.arcSize(i);k++)
+          label_buffer[tree.arcBegin(i)[k]] = i;
+      }
+    }
+
+    for (uint32_t m=0;m<metrics.size();m++) {
+      const char* metric_name = gMetricTypeOptions[gMetrics[m]];
+      std::vector<FunctionType> values(node_values[m]);
+      SegmentationHierarchy hierarchy;
+
+      if (values.empty()) {
+        values.resize(tree.size());
+        for (LocalIndexType i=0;i<tree.size();i++)
+          values[i] = metrics[m]->eval(tree.node(i).index(),i);
+      }
 
-  // If the metric needs augmented arcs we assume we need to evaluate it
-  // per tree
-  if (augmented)
-    metric->eval(tree);
+      hierarchy.build(tree,values,metric_name,metrics[m]->descending(greater));
+
+      std::string filename = std::string(gHierarchyFileName)
+                             + ((metrics.size() > 1) ? std::string(".") + metric_name : "");
+
+      if (hierarchy.write(filename.c_str(),labels,gDim) == 0)
+        return 0;
+    }
+  }
+
+  // Compute the per-feature statistics if requested. The labels are only
+  // up to date for unsplit trees so augmented trees use their arcs instead
+  if (gAttributeFileName != NULL) {
+    FeatureAttributes attributes;
+
+    if (augmented)
+      attributes.computeFromArcs(tree,gData,gDim);
+    else
+      attributes.computeFromLabels(tree,labels,gData,gDim);
+
+    attributes.accumulate(tree);
+
+    // Report coordinates in the frame of the output volume
+    if (gROIFullOutput)
+      attributes.translate(gROILow);
+
+    FILE* attribute_file = fopen(gAttributeFileName,"wb");
+    if (attribute_file == NULL) {
+      fprintf(stderr,"Error, could not open attribute file \"%s\"\n",gAttributeFileName);
+      return 0;
+    }
+    // Buffered records only reach the file when it is closed
+    int written = attributes.write(attribute_file,tree);
+    if ((fclose(attribute_file) != 0) || (written == 0)) {
+      fprintf(stderr,"Error, could not write attribute file \"%s\"\n",gAttributeFileName);
+      return 0;
+    }
+  }
 
   // Prepare the output
   GlobalIndexType progress = 0;
   GlobalIndexType next = 0;
 
-  FILE* output;
+  // The output either matches the processed region or the full volume
+  // with the region embedded
+  const GlobalIndexType* out_dim = gROIFullOutput ? gFullDim : gDim;
+  GlobalIndexType plane_size = gDim[0]*gDim[1];
 
-  if (gOutputFileName == NULL)
-    output = stdout;
-  else
-    output = fopen(gOutputFileName,"wb");
+  // One output (and quantization) per metric, written by separate threads
+  // while the next planes are computed
+  std::vector<Quantizer> quantizers(metrics.size());
+  std::vector<VolumeOutput*> outputs(metrics.size(),NULL);
+  std::vector<std::vector<FunctionType> > transforms(metrics.size());
+  std::vector<std::vector<FunctionType> > full_transforms(metrics.size());
+  std::vector<FunctionType> fill(metrics.size());
+
+  for (uint32_t m=0;m<metrics.size();m++) {
+    const char* metric_name = gMetricTypeOptions[gMetrics[m]];
+    const Quantizer* quantizer = NULL;
+
+    fill[m] = metrics[m]->fillValue();
+    transforms[m].resize(plane_size);
+
+    if (gQuantizeBits > 0) {
+      FunctionType low,high;
+
+      metrics[m]->range(low,high);
+      quantizers[m].initialize(low,high,gQuantizeBits);
+      quantizer = &quantizers[m];
+
+      fprintf(stderr,"Quantizing %s [%f,%f] to %d bits with a maximal error of %g\n",
+              metric_name,low,high,gQuantizeBits,quantizers[m].errorBound());
+    }
+
+    switch (gFormat) {
+      case FORMAT_RAW:
+        outputs[m] = new RawOutput(out_dim,quantizer);
+        break;
+      case FORMAT_BRICKED:
+        outputs[m] = new BrickedWriter(out_dim,gBrickSize,quantizer,metric_name,gTreeType,
+                                       gThreshold,fill[m]);
+        break;
+      case FORMAT_SPARSE:
+        outputs[m] = new SparseWriter(out_dim,quantizer,fill[m]);
+        break;
+    }
 
-  // Now we compute and output the transformed volume
-  for (GlobalIndexType k=0;k<gDim[2];k++) {
+    // With several metrics each output is named after its metric
+    std::string filename;
+    if (gOutputFileName != NULL)
+      filename = std::string(gOutputFileName) + ((metrics.size() > 1) ? std::string(".") + metric_name : "");
+
+    if (outputs[m]->open((gOutputFileName == NULL) ? NULL : filename.c_str(),gDirectIO) == 0)
+      return 0;
+
+    if (gROIFullOutput)
+      full_transforms[m].resize(gFullDim[0]*gFullDim[1],fill[m]);
+  }
+
+  // Full size plane of labels into which the region is copied
+  std::vector<LocalIndexType> full_labels;
+
+  if (gROIFullOutput)
+    full_labels.resize(gFullDim[0]*gFullDim[1],LNULL);
+
+  // Whole bricks of the output can be filled without looking at their labels
+  std::vector<char> active;
+  uint32_t brick_size = gDim[0];
+
+  if (!bricks.empty()) {
+    bricks.activeBricks(greater,gThreshold,active);
+    brick_size = bricks.brickSize();
+  }
+
+  uint32_t brick_columns = (gDim[0] + brick_size - 1) / brick_size;
+
+  // Now we compute and output the transformed volumes evaluating all
+  // metrics in a single pass over the labels
+  for (GlobalIndexType k=0;k<out_dim[2];k++) {
     if (100*progress/(size) >= next) {
       fprintf(stderr,"Transforming volume  %03lld%%\r",100*progress/size);
       next++;
     }
 
-    if (augmented) {
-      for (LocalIndexType i=0;i<gDim[0]*gDim[1];i++) {
-        if (labels[progress] != LNULL)
-          transform[i] = tree.node(labels[progress]).metric();
-        else
-          transform[i] = metric->fillValue();
-        progress++;
+    // The plane of the region corresponding to the k'th output plane
+    GlobalIndexType z = gROIFullOutput ? k - gROILow[2] : k;
+    bool inside = !gROIFullOutput || ((k >= gROILow[2]) && (k < gROIHigh[2]));
+
+    if (inside) {
+      for (GlobalIndexType y=0;y<gDim[1];y++) {
+        for (uint32_t bx=0;bx<brick_columns;bx++) {
+          GlobalIndexType first = y*gDim[0] + bx*brick_size;
+          GlobalIndexType last = y*gDim[0] + std::min((GlobalIndexType)(bx+1)*brick_size,gDim[0]);
+
+          // Rejected bricks contain no labeled vertices
+          if (!active.empty() && !active[bricks.brick(bx,y / brick_size,z / brick_size)]) {
+            for (uint32_t m=0;m<metrics.size();m++)
+              std::fill(&transforms[m][first],&transforms[m][first] + (last - first),fill[m]);
+            continue;
+          }
+
+          for (GlobalIndexType i=first;i<last;i++) {
+            LocalIndexType label = labels[progress + i];
+
+            for (uint32_t m=0;m<metrics.size();m++) {
+              if (node_values[m].empty())
+                transforms[m][i] = metrics[m]->eval(progress + i,label);
+              else if (label != LNULL)
+                transforms[m][i] = node_values[m][label];
+              else
+                transforms[m][i] = fill[m];
+            }
+          }
+        }
       }
+      progress += plane_size;
     }
-    else {
-      for (LocalIndexType i=0;i<gDim[0]*gDim[1];i++) {
-        transform[i] = metric->eval(progress,labels[progress]);
-        progress++;
+
+    if (!gROIFullOutput) {
+      for (uint32_t m=0;m<metrics.size();m++) {
+        if (outputs[m]->writePlane(&transforms[m][0],labels + z*plane_size) == 0)
+          return 0;
       }
+      continue;
     }
-    fwrite(transform,sizeof(FunctionType),gDim[0]*gDim[1],output);
-  }
 
-  if (gOutputFileName != NULL)
-    fclose(output);
+    // Copy the rows of the region into the full planes or reset them if
+    // this plane lies outside the region
+    for (GlobalIndexType y=0;y<gDim[1];y++) {
+      GlobalIndexType offset = (gROILow[1] + y)*gFullDim[0] + gROILow[0];
+
+      if (inside) {
+        for (uint32_t m=0;m<metrics.size();m++)
+          std::copy(&transforms[m][y*gDim[0]],&transforms[m][y*gDim[0]] + gDim[0],
+                    &full_transforms[m][offset]);
+        std::copy(labels + (z*gDim[1] + y)*gDim[0],labels + (z*gDim[1] + y + 1)*gDim[0],
+                  &full_labels[offset]);
+      }
+      else {
+        for (uint32_t m=0;m<metrics.size();m++)
+          std::fill(&full_transforms[m][offset],&full_transforms[m][offset] + gDim[0],fill[m]);
+        std::fill(&full_labels[offset],&full_labels[offset] + gDim[0],LNULL);
+      }
+    }
 
-  delete[] gData;
-  delete[] transform;
-  delete[] labels;
-  delete metric;
+    for (uint32_t m=0;m<metrics.size();m++) {
+      if (outputs[m]->writePlane(&full_transforms[m][0],&full_labels[0]) == 0)
+        return 0;
+    }
+  }
 
-  return 1;
-}
+  fprintf(stderr,"Transforming volume  100%%\n");
+  for (uint32_t m=0;m<metrics.size();m++) {
+    if (outputs[m]->close() == 0)
+      return 0;
 
+    delete outputs[m];
+    delete metrics[m];
+  }
 
+  delete[] label_buffer;
 
+  return 1;
+}
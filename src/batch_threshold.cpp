@@ -0,0 +1,983 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glob.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "FullNeighborhood.h"
+#include "MergeTree.h"
+#include "MTAlgorithm.h"
+#include "InputVolume.h"
+#include "BrickIndex.h"
+#include "VolumeOutput.h"
+#include "Relevance.h"
+#include "R2.h"
+#include "Threshold.h"
+#include "LocalThreshold.h"
+#include "Pipeline.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 18
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--list",
+    "--dim",
+    "--dtype",
+    "--swap-bytes",
+    "--no-mmap",
+
+    "--tree-type",
+    "--threshold",
+    "--threshold-quantile",
+    "--sort",
+    "--summary-size",
+    "--metric",
+
+    "--output-dir",
+    "--jobs",
+    "--memory",
+    "--pipeline",
+    "--warm-start",
+};
+
+//! Global array of data of the volume processed by the current thread
+/*! Being thread local the OpenMP workers of a stage do not see it, so
+ *  parallel regions read it through a local copy
+ */
+thread_local const FunctionType* gData = NULL;
+
+//! Global array of dimensions of the volume processed by the current thread
+thread_local GlobalIndexType gDim[3] = {0,0,0};
+
+//! The dimensions of all inputs that do not specify their own
+GlobalIndexType gDefaultDim[3] = {0,0,0};
+
+//! The type of the values stored in the input files
+DataType gDataType = DATA_FLOAT32;
+
+//! Whether the byte order of the input files differs from the host
+bool gSwapBytes = false;
+
+//! Whether the input files should be memory mapped
+bool gUseMMap = true;
+
+//! Tree type 0 (merge tree), 1 (split tree)
+int gTreeType = 0;
+
+//! The lower (merge tree) or upper (split tree) threshold
+FunctionType gThreshold = 0;
+
+//! Fraction of the vertices to keep or a negative value to use gThreshold
+double gThresholdQuantile = -1;
+
+//! Number of sort types
+#define NUM_SORT_TYPES 3
+//! List of available sort types
+static const char* gSortTypeOptions[NUM_SORT_TYPES] = {
+    "auto",
+    "generic",
+    "counting",
+};
+//! The sort used to order the vertices
+SortType gSortType = SORT_AUTO;
+
+//! The brick size of the min/max summary used to skip empty space (0 to disable)
+uint32_t gSummarySize = 16;
+
+//! Number of metrics
+#define NUM_METRIC_TYPES 4
+//! List of available metrics
+static const char* gMetricTypeOptions[NUM_METRIC_TYPES] = {
+    "relevance",
+    "R2",
+    "threshold",
+    "local",
+};
+//! Enum of metrics
+enum MetricType {
+  METRIC_RELEVANCE = 0,
+  METRIC_R2 = 1,
+  METRIC_THRESHOLD = 2,
+  METRIC_LOCAL = 3,
+};
+//! The metric of the transformed volumes
+MetricType gMetric = METRIC_RELEVANCE;
+
+//! The directory the transformed volumes are written to (NULL to skip the output)
+const char* gOutputDir = NULL;
+
+//! The number of volumes processed concurrently
+uint32_t gJobs = 1;
+
+//! The memory the concurrently processed volumes may reserve in bytes (0 for no limit)
+uint64_t gMemoryLimit = 0;
+
+//! The number of consecutive volumes in flight in the pipelined mode (0 to use workers)
+uint32_t gPipelineSlots = 0;
+
+//! Whether the sort of each volume starts from the order of the previous one
+bool gWarmStart = false;
+
+//! One input volume of the batch and its statistics
+class BatchJob
+{
+public:
+
+  //! Default constructor
+  BatchJob() : mSeconds(0), mVertices(0), mNodes(0), mStatus(0) {mDim[0] = mDim[1] = mDim[2] = 0;}
+
+  //! The name of the input file
+  std::string mFileName;
+
+  //! The dimensions of the volume
+  GlobalIndexType mDim[3];
+
+  //! The time from the start of the read until the output is written
+  double mSeconds;
+
+  //! The number of vertices above the threshold
+  GlobalIndexType mVertices;
+
+  //! The number of nodes of the tree
+  LocalIndexType mNodes;
+
+  //! 1 if the volume was processed successfully and 0 otherwise
+  int mStatus;
+};
+
+//! The order of the previously sorted volume used to warm start the next sort
+class WarmStart
+{
+public:
+
+  //! Default constructor
+  WarmStart() {mDim[0] = mDim[1] = mDim[2] = 0;}
+
+  //! The sorted vertices above the threshold
+  std::vector<GlobalIndexType> mOrder;
+
+  //! The dimensions of the volume
+  GlobalIndexType mDim[3];
+};
+
+//! The storage of one worker that is reused from one volume to the next
+/*! Inputs of the same (or smaller) size reuse the input buffer, labels,
+ *  vertex order, union-find, tree nodes and the output buffers of the previous
+ *  volume so that a batch of similar volumes allocates only once.
+ */
+class BatchWorker
+{
+public:
+
+  //! Default constructor
+  BatchWorker() : mJob(NULL), mThreshold(0), mLow(0), mExpected(0), mWarmStart(NULL), mMetric(NULL),
+                  mOutput(NULL), mReserved(0) {mOutputDim[0] = mOutputDim[1] = mOutputDim[2] = 0;}
+
+  //! Destructor
+  ~BatchWorker() {delete mMetric;delete mOutput;}
+
+  //! Release all storage except the warm start order
+  void release();
+
+  //! The volume currently processed
+  BatchJob* mJob;
+
+  //! The time the read of the current volume started
+  std::chrono::steady_clock::time_point mStart;
+
+  //! The input volume
+  InputVolume mInput;
+
+  //! The threshold of the current volume
+  FunctionType mThreshold;
+
+  //! The global minimum of the current volume
+  FunctionType mLow;
+
+  //! The number of vertices above a quantile threshold or 0
+  GlobalIndexType mExpected;
+
+  //! The min/max summary of the input
+  BrickIndex mBricks;
+
+  //! The tree
+  MergeTree mTree;
+
+  //! The label of every vertex
+  std::vector<LocalIndexType> mLabels;
+
+  //! The sorted vertices above the threshold
+  std::vector<GlobalIndexType> mOrder;
+
+  //! The order of the previous volume or NULL if the sort is not warm started
+  WarmStart* mWarmStart;
+
+  //! The union-find structure of the sweep
+  UnionFind mUnionFind;
+
+  //! The metric values of all nodes if the metric needs augmented arcs
+  std::vector<FunctionType> mNodeValues;
+
+  //! The transformed volume
+  std::vector<FunctionType> mTransform;
+
+  //! The metric
+  Metric* mMetric;
+
+  //! The output which is kept as long as the dimensions do not change
+  RawOutput* mOutput;
+
+  //! The dimensions of the output
+  GlobalIndexType mOutputDim[3];
+
+  //! The memory currently reserved by this worker in bytes
+  uint64_t mReserved;
+};
+
+void BatchWorker::release()
+{
+  mInput.clear();
+  mTree = MergeTree();
+  std::vector<LocalIndexType>().swap(mLabels);
+  std::vector<GlobalIndexType>().swap(mOrder);
+  std::vector<FunctionType>().swap(mNodeValues);
+  std::vector<FunctionType>().swap(mTransform);
+
+  // The warm start order is kept since it seeds the sort of the next volume
+}
+
+//! All volumes of the batch
+std::vector<BatchJob> gBatch;
+
+//! The index of the next volume to be processed
+std::atomic<size_t> gNextJob(0);
+
+//! Lock protecting the memory accounting and the report
+std::mutex gMemoryMutex;
+
+//! Signaled whenever a worker releases memory
+std::condition_variable gMemoryReleased;
+
+//! The memory currently reserved by all workers
+uint64_t gMemoryReserved = 0;
+
+//! The largest amount of memory reserved at any time
+uint64_t gMemoryPeak = 0;
+
+//! Create the given metric
+Metric* create_metric(MetricType type)
+{
+  switch (type) {
+    case METRIC_RELEVANCE:
+      return new Relevance();
+    case METRIC_R2:
+      return new R2();
+    case METRIC_THRESHOLD:
+      return new Threshold();
+    case METRIC_LOCAL:
+      return new LocalThreshold();
+  }
+
+  return NULL;
+}
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s [--i <pattern>] [--list <filename>] --dim <int> <int> <int> [options]\n\n",exec);
+  fprintf(output,"Compute the merge tree and transformed volume of many raw volumes. Workers process\n");
+  fprintf(output,"several volumes concurrently and reuse their buffers and tree storage from one\n");
+  fprintf(output,"volume to the next. The time and throughput of every volume are printed to stdout\n");
+  fprintf(output,"as they finish followed by the aggregate throughput of the batch.\n\n");
+  fprintf(output,"--i <pattern>\n\tAdd all files matching the given glob pattern (may be repeated)\n");
+  fprintf(output,"--list <filename>\n\tAdd the files listed one per line. A line may give the dimensions of its\n\
+      \tfile after the name, otherwise those of --dim are used\n");
+  fprintf(output,"--dtype <string>\n\tType of the input values: uint8, uint16, int32, float16, float32 (default), or double.\n\
+      \tValues are converted to float while loading (int32 and double may lose precision)\n");
+  fprintf(output,"--swap-bytes\n\tThe byte order of the input files differs from the host\n");
+  fprintf(output,"--no-mmap\n\tRead the inputs into memory rather than memory mapping them\n");
+  fprintf(output,"--tree-type [0 | 1]\n\tWhether to compute merge (0, default) or split tree (1)\n");
+  fprintf(output,"--threshold <float>\n\tThe lower (merge tree) or upper (split tree) threshold\n");
+  fprintf(output,"--threshold-quantile <float>\n\tChoose the threshold of every volume such that this fraction of\n\
+      \tits vertices lies above it\n");
+  fprintf(output,"--sort <string>\n\tauto (default), generic or counting\n");
+  fprintf(output,"--summary-size <int>\n\tEdge length of the bricks of the min/max summary (default 16, 0 disables the summary)\n");
+  fprintf(output,"--metric <string>\n\trelevance (default), R2, threshold or local\n");
+  fprintf(output,"--output-dir <dirname>\n\tWrite the transformed volume of every input as <dirname>/<basename>.<metric>.\n\
+      \tWithout it only the trees and metrics are computed\n");
+  fprintf(output,"--jobs <int>\n\tThe number of volumes processed concurrently (default 1)\n");
+  fprintf(output,"--pipeline <int>\n\tProcess the volumes in the given order as consecutive timesteps in separate\n\
+      \tread, sort, sweep, metric and write stages with at most the given number of\n\
+      \tvolumes in flight, e.g. timestep t+1 is read and sorted while t is swept and t-1\n\
+      \twritten. Replaces --jobs and --memory and reports the utilization of every stage\n");
+  fprintf(output,"--warm-start\n\tSeed the sort of every volume with the order of the previously sorted one, which\n\
+      \tis nearly sorted already for consecutive timesteps of a slowly evolving simulation\n");
+  fprintf(output,"--memory <int>\n\tThe memory in MB the concurrent volumes may use together (default unlimited).\n\
+      \tA volume that does not fit waits until enough memory is released but is always\n\
+      \tadmitted if nothing else is running\n");
+}
+
+/*! \brief Add all files listed in the given file
+ *
+ * \param filename : The name of the list
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int read_list(const char* filename)
+{
+  FILE* list = fopen(filename,"r");
+  char line[4096];
+
+  if (list == NULL) {
+    fprintf(stderr,"Error, could not open file list \"%s\"\n",filename);
+    return 0;
+  }
+
+  while (fgets(line,sizeof(line),list) != NULL) {
+    char name[4096];
+    unsigned long long dim[3];
+    BatchJob job;
+
+    int fields = sscanf(line,"%4095s %llu %llu %llu",name,dim,dim+1,dim+2);
+
+    // Skip empty lines and comments
+    if ((fields <= 0) || (name[0] == '#'))
+      continue;
+
+    job.mFileName = name;
+    for (int i=0;i<3;i++)
+      job.mDim[i] = (fields == 4) ? dim[i] : 0;
+
+    gBatch.push_back(job);
+  }
+
+  fclose(list);
+
+  return 1;
+}
+
+/*! \brief Add all files matching the given glob pattern
+ *
+ * \param pattern : The pattern
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int expand_pattern(const char* pattern)
+{
+  glob_t matches;
+
+  if (glob(pattern,0,NULL,&matches) != 0) {
+    fprintf(stderr,"Error, no file matches \"%s\"\n",pattern);
+    return 0;
+  }
+
+  for (size_t k=0;k<matches.gl_pathc;k++) {
+    BatchJob job;
+
+    job.mFileName = matches.gl_pathv[k];
+    gBatch.push_back(job);
+  }
+
+  globfree(&matches);
+
+  return 1;
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      if (expand_pattern(argv[++i]) == 0)
+        return 0;
+      break;
+    case 2: // --list
+      if (read_list(argv[++i]) == 0)
+        return 0;
+      break;
+    case 3: // --dim
+      gDefaultDim[0] = atoi(argv[++i]);
+      gDefaultDim[1] = atoi(argv[++i]);
+      gDefaultDim[2] = atoi(argv[++i]);
+      break;
+    case 4: // --dtype
+      i++;
+      if (parse_data_type(argv[i],gDataType) == 0) {
+        fprintf(stderr,"Sorry, the data type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 5: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 6: // --no-mmap
+      gUseMMap = false;
+      break;
+    case 7: // --tree-type
+      gTreeType = atoi(argv[++i]);
+      break;
+    case 8: // --threshold
+      gThreshold = (FunctionType)atof(argv[++i]);
+      break;
+    case 9: // --threshold-quantile
+      gThresholdQuantile = atof(argv[++i]);
+      if ((gThresholdQuantile < 0) || (gThresholdQuantile > 1)) {
+        fprintf(stderr,"Sorry, the quantile must lie in [0,1] .....\n");
+        return 0;
+      }
+      break;
+    case 10: // --sort
+      i++;
+      for (j=0; j < NUM_SORT_TYPES;j++) {
+        if(strcmp(gSortTypeOptions[j],argv[i])==0) {
+          gSortType = (SortType)j;
+          break;
+        }
+      }
+      if (j == NUM_SORT_TYPES) {
+        fprintf(stderr,"Sorry, the sort type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 11: // --summary-size
+      gSummarySize = atoi(argv[++i]);
+      break;
+    case 12: // --metric
+      i++;
+      for (j=0; j < NUM_METRIC_TYPES;j++) {
+        if(strcmp(gMetricTypeOptions[j],argv[i])==0) {
+          gMetric = (MetricType)j;
+          break;
+        }
+      }
+      if (j == NUM_METRIC_TYPES) {
+        fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 13: // --output-dir
+      gOutputDir = argv[++i];
+      break;
+    case 14: // --jobs
+      gJobs = std::max(atoi(argv[++i]),1);
+      break;
+    case 15: // --memory
+      gMemoryLimit = strtoull(argv[++i],NULL,10) << 20;
+      break;
+    case 16: // --pipeline
+      gPipelineSlots = std::max(atoi(argv[++i]),1);
+      break;
+    case 17: // --warm-start
+      gWarmStart = true;
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+//! Return the memory in bytes needed to process a volume with the given dimensions
+uint64_t job_memory(const GlobalIndexType dim[3], bool augmented)
+{
+  uint64_t count = dim[0]*dim[1]*dim[2];
+
+  // The data, the labels, at most every vertex in the order and the
+  // transformed volume. The augmented arcs and the warm start store every
+  // vertex once more
+  return count*(sizeof(FunctionType) + sizeof(LocalIndexType) + sizeof(GlobalIndexType)
+                + ((gOutputDir != NULL) ? sizeof(FunctionType) : 0)
+                + (gWarmStart ? sizeof(GlobalIndexType) : 0)
+                + (augmented ? sizeof(GlobalIndexType) : 0));
+}
+
+/*! \brief Make sure the worker has reserved at least the given memory
+ *
+ * A worker that needs more than it holds gives up its storage and
+ * reservation first so that waiting workers never hold memory. A volume
+ * is admitted once it fits into the limit or no other volume is running.
+ */
+void reserve_memory(BatchWorker& worker, uint64_t bytes)
+{
+  if (bytes <= worker.mReserved)
+    return;
+
+  std::unique_lock<std::mutex> lock(gMemoryMutex);
+
+  gMemoryReserved -= worker.mReserved;
+  worker.mReserved = 0;
+  worker.release();
+  gMemoryReleased.notify_all();
+
+  gMemoryReleased.wait(lock,[bytes]() {
+    return (gMemoryLimit == 0) || (gMemoryReserved == 0) || (gMemoryReserved + bytes <= gMemoryLimit);
+  });
+
+  gMemoryReserved += bytes;
+  gMemoryPeak = std::max(gMemoryPeak,gMemoryReserved);
+  worker.mReserved = bytes;
+}
+
+//! Return the reservation of a worker that has no more volumes to process
+void release_memory(BatchWorker& worker)
+{
+  std::unique_lock<std::mutex> lock(gMemoryMutex);
+
+  gMemoryReserved -= worker.mReserved;
+  worker.mReserved = 0;
+  worker.release();
+  gMemoryReleased.notify_all();
+}
+
+//! Make the volume of the worker the one the library functions of this thread operate on
+void select_volume(BatchWorker& worker)
+{
+  std::copy(worker.mJob->mDim,worker.mJob->mDim + 3,gDim);
+  gData = worker.mInput.data();
+}
+
+//! Read the volume and summarize it
+int read_volume(BatchWorker& worker)
+{
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+  BatchJob& job = *worker.mJob;
+
+  worker.mStart = std::chrono::steady_clock::now();
+
+  if (worker.mInput.read(job.mFileName.c_str(),job.mDim,gDataType,gSwapBytes,gUseMMap) == 0)
+    return 0;
+
+  select_volume(worker);
+
+  worker.mThreshold = gThreshold;
+  worker.mExpected = 0;
+
+  if (gThresholdQuantile >= 0)
+    worker.mThreshold = quantile_threshold(gData,gDim[0]*gDim[1]*gDim[2],greater,gThresholdQuantile,
+                                           worker.mExpected);
+
+  if (gSummarySize > 0)
+    worker.mBricks.build(gData,gDim,gSummarySize);
+
+  return 1;
+}
+
+//! Screen and sort the vertices above the threshold
+int sort_volume(BatchWorker& worker)
+{
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+  SweepOptions options;
+
+  select_volume(worker);
+
+  options.mDomain = data_type_domain(gDataType);
+  options.mSort = gSortType;
+  options.mBricks = (gSummarySize > 0) ? &worker.mBricks : NULL;
+  options.mReserve = worker.mExpected;
+
+  // The previous order is only a valid hint for a volume of the same size
+  WarmStart* warm = worker.mWarmStart;
+  if ((warm != NULL) && std::equal(gDim,gDim + 3,warm->mDim))
+    options.mHint = &warm->mOrder;
+
+  worker.mLabels.resize(gDim[0]*gDim[1]*gDim[2]);
+
+  if (sort_vertices(greater,worker.mThreshold,worker.mLabels.data(),options,worker.mOrder,
+                    worker.mLow) == 0)
+    return 0;
+
+  if (warm != NULL) {
+    warm->mOrder.assign(worker.mOrder.begin(),worker.mOrder.end());
+    std::copy(gDim,gDim + 3,warm->mDim);
+  }
+
+  return 1;
+}
+
+//! Compute the tree and labels from the sorted vertices
+int sweep_volume(BatchWorker& worker)
+{
+  select_volume(worker);
+
+  FullNeighborhood neighborhood(gDim);
+
+  worker.mTree.clear();
+
+  if (sweep_sorted_vertices(neighborhood,worker.mOrder,worker.mLow,worker.mTree,
+                            worker.mMetric->explicitArcs(),worker.mLabels.data(),
+                            &worker.mUnionFind) == 0)
+    return 0;
+
+  worker.mJob->mVertices = worker.mOrder.size();
+  worker.mJob->mNodes = worker.mTree.size();
+
+  return 1;
+}
+
+//! Evaluate the metric and (if there is an output) the transformed volume
+int evaluate_metric(BatchWorker& worker)
+{
+  Metric& metric = *worker.mMetric;
+
+  select_volume(worker);
+
+  metric.initialize(gData,&worker.mTree);
+
+  // Metrics that need augmented arcs are evaluated per node
+  worker.mNodeValues.clear();
+  if (metric.explicitArcs()) {
+    metric.eval(worker.mTree);
+
+    worker.mNodeValues.resize(worker.mTree.size());
+    for (LocalIndexType i=0;i<worker.mTree.size();i++)
+      worker.mNodeValues[i] = worker.mTree.node(i).metric();
+  }
+
+  if (gOutputDir == NULL)
+    return 1;
+
+  GlobalIndexType size = gDim[0]*gDim[1]*gDim[2];
+  const LocalIndexType* labels = worker.mLabels.data();
+  const std::vector<FunctionType>& node_values = worker.mNodeValues;
+  FunctionType fill = metric.fillValue();
+
+  worker.mTransform.resize(size);
+  FunctionType* transform = worker.mTransform.data();
+
+#pragma omp parallel for schedule(static)
+  for (int64_t i=0;i<(int64_t)size;i++) {
+    if (node_values.empty())
+      transform[i] = metric.eval(i,labels[i]);
+    else if (labels[i] != LNULL)
+      transform[i] = node_values[labels[i]];
+    else
+      transform[i] = fill;
+  }
+
+  return 1;
+}
+
+//! Write the transformed volume
+int write_volume(BatchWorker& worker)
+{
+  BatchJob& job = *worker.mJob;
+
+  if (gOutputDir == NULL)
+    return 1;
+
+  // The output and its buffers are only recreated if the dimensions change
+  if ((worker.mOutput == NULL) || !std::equal(job.mDim,job.mDim + 3,worker.mOutputDim)) {
+    delete worker.mOutput;
+    worker.mOutput = new RawOutput(job.mDim,NULL);
+    std::copy(job.mDim,job.mDim + 3,worker.mOutputDim);
+  }
+
+  std::string basename = job.mFileName.substr(job.mFileName.find_last_of('/') + 1);
+  std::string filename = std::string(gOutputDir) + "/" + basename + "." + gMetricTypeOptions[gMetric];
+
+  if (worker.mOutput->open(filename.c_str()) == 0)
+    return 0;
+
+  GlobalIndexType plane_size = job.mDim[0]*job.mDim[1];
+
+  for (GlobalIndexType z=0;z<job.mDim[2];z++) {
+    if (worker.mOutput->writePlane(&worker.mTransform[z*plane_size],&worker.mLabels[z*plane_size]) == 0)
+      return 0;
+  }
+
+  return worker.mOutput->close();
+}
+
+//! The stages every volume passes through in order
+static int (*gStages[5])(BatchWorker&) = {
+    read_volume,
+    sort_volume,
+    sweep_volume,
+    evaluate_metric,
+    write_volume,
+};
+
+//! Names of the stages
+static const char* gStageNames[5] = {
+    "read",
+    "sort",
+    "sweep",
+    "metric",
+    "write",
+};
+
+//! Run the given stage unless an earlier stage of the volume has failed
+void run_stage(uint32_t stage, BatchWorker& worker)
+{
+  if (stage == 0)
+    worker.mJob->mStatus = 1;
+
+  if (worker.mJob->mStatus == 1)
+    worker.mJob->mStatus = gStages[stage](worker);
+}
+
+//! Print the statistics of a finished volume
+void report_job(BatchWorker& worker)
+{
+  BatchJob& job = *worker.mJob;
+  GlobalIndexType size = job.mDim[0]*job.mDim[1]*job.mDim[2];
+
+  job.mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - worker.mStart).count();
+
+  std::unique_lock<std::mutex> lock(gMemoryMutex);
+
+  if (job.mStatus == 0)
+    fprintf(stdout,"%s failed\n",job.mFileName.c_str());
+  else
+    fprintf(stdout,"%s %llu voxels %llu vertices %u nodes %.3f s %.1f MVoxel/s\n",job.mFileName.c_str(),
+            (unsigned long long)size,(unsigned long long)job.mVertices,job.mNodes,job.mSeconds,
+            size / std::max(job.mSeconds,1e-9) / 1e6);
+  fflush(stdout);
+}
+
+//! Process volumes of the batch until none are left
+void run_worker(uint32_t threads)
+{
+  BatchWorker worker;
+  size_t k;
+
+#ifdef _OPENMP
+  // The cores are shared evenly among the concurrent volumes
+  omp_set_num_threads(threads);
+#endif
+
+  WarmStart warm;
+
+  worker.mMetric = create_metric(gMetric);
+  if (gWarmStart)
+    worker.mWarmStart = &warm;
+
+  while ((k = gNextJob++) < gBatch.size()) {
+    BatchJob& job = gBatch[k];
+
+    reserve_memory(worker,job_memory(job.mDim,worker.mMetric->explicitArcs()));
+
+    worker.mJob = &job;
+    for (uint32_t stage=0;stage<5;stage++)
+      run_stage(stage,worker);
+
+    report_job(worker);
+  }
+
+  release_memory(worker);
+}
+
+//! Pass the volumes as consecutive timesteps through the stages of a pipeline
+void run_pipeline()
+{
+  std::vector<BatchWorker> slots(gPipelineSlots);
+  Pipeline pipeline(gPipelineSlots);
+  WarmStart warm;
+  uint32_t threads = 0;
+
+#ifdef _OPENMP
+  // The sweep is sequential and reading and writing are mostly waiting
+  // for I/O, so the sort and metric stages share the cores
+  threads = std::max(omp_get_max_threads() / 2,1);
+#endif
+
+  // The single sort stage passes the order of each timestep on to the next
+  for (uint32_t k=0;k<gPipelineSlots;k++) {
+    slots[k].mMetric = create_metric(gMetric);
+    if (gWarmStart)
+      slots[k].mWarmStart = &warm;
+  }
+
+  for (uint32_t stage=0;stage<5;stage++) {
+    pipeline.addStage(gStageNames[stage],[stage,&slots](uint32_t slot, uint32_t item) {
+      BatchWorker& worker = slots[slot];
+
+      if (stage == 0)
+        worker.mJob = &gBatch[item];
+
+      run_stage(stage,worker);
+
+      if (stage == 4)
+        report_job(worker);
+    },threads);
+  }
+
+  fprintf(stderr,"Processing %zu volumes in a pipeline of %u slots\n",gBatch.size(),gPipelineSlots);
+
+  pipeline.run(gBatch.size());
+  pipeline.report(stdout);
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  if (gBatch.empty()) {
+    fprintf(stderr,"Error, no input files given\n");
+    return 0;
+  }
+
+  for (size_t k=0;k<gBatch.size();k++) {
+    if (gBatch[k].mDim[0] == 0)
+      std::copy(gDefaultDim,gDefaultDim + 3,gBatch[k].mDim);
+
+    if (gBatch[k].mDim[0]*gBatch[k].mDim[1]*gBatch[k].mDim[2] == 0) {
+      fprintf(stderr,"Error, no dimensions given for \"%s\"\n",gBatch[k].mFileName.c_str());
+      return 0;
+    }
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  if (gPipelineSlots > 0)
+    run_pipeline();
+  else {
+    // Sorting the batch by size keeps inputs of the same dimensions on the
+    // same worker as long as possible so their storage is reused
+    std::stable_sort(gBatch.begin(),gBatch.end(),[](const BatchJob& a, const BatchJob& b) {
+      return a.mDim[0]*a.mDim[1]*a.mDim[2] > b.mDim[0]*b.mDim[1]*b.mDim[2];
+    });
+
+    gJobs = std::min(gJobs,(uint32_t)gBatch.size());
+
+    uint32_t threads = 1;
+#ifdef _OPENMP
+    threads = std::max(omp_get_max_threads() / (int)gJobs,1);
+#endif
+
+    fprintf(stderr,"Processing %zu volumes with %u workers of %u threads each\n",gBatch.size(),gJobs,threads);
+
+    std::vector<std::thread> workers;
+
+    for (uint32_t w=0;w<gJobs;w++)
+      workers.push_back(std::thread(run_worker,threads));
+
+    for (uint32_t w=0;w<gJobs;w++)
+      workers[w].join();
+
+    fprintf(stdout,"Peak memory reservation %.1f MB\n",gMemoryPeak / (double)(1 << 20));
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  GlobalIndexType voxels = 0;
+  size_t failed = 0;
+
+  for (size_t k=0;k<gBatch.size();k++) {
+    if (gBatch[k].mStatus == 0)
+      failed++;
+    else
+      voxels += gBatch[k].mDim[0]*gBatch[k].mDim[1]*gBatch[k].mDim[2];
+  }
+
+  fprintf(stdout,"Processed %zu of %zu volumes (%llu voxels) in %.3f s: %.2f volumes/s %.1f MVoxel/s\n",
+          gBatch.size() - failed,gBatch.size(),(unsigned long long)voxels,seconds,
+          (gBatch.size() - failed) / std::max(seconds,1e-9),voxels / std::max(seconds,1e-9) / 1e6);
+
+  return (failed == 0) ? 1 : 0;
+}
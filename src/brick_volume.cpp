@@ -0,0 +1,243 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include "Definitions.h"
+#include "InputVolume.h"
+#include "Quantizer.h"
+#include "BrickedVolume.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 11
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--o",
+
+    "--dim",
+    "--dtype",
+    "--swap-bytes",
+    "--offset",
+    "--stride",
+    "--component",
+    "--brick-size",
+    "--no-mmap",
+};
+
+//! Name of the input file
+const char* gInputFileName = NULL;
+
+//! Name of the output file
+const char* gOutputFileName = NULL;
+
+//! Global array of dimensions
+GlobalIndexType gDim[3] = {0,0,0};
+
+//! The type of the values stored in the input file
+DataType gDataType = DATA_FLOAT32;
+
+//! Whether the byte order of the input file differs from the host
+bool gSwapBytes = false;
+
+//! The location of the values within the input file
+InputLayout gLayout;
+
+//! The edge length of the bricks
+uint32_t gBrickSize = 32;
+
+//! Whether the input file should be memory mapped
+bool gUseMMap = true;
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s --i <filename> --o <filename> --dim <int> <int> <int> [options]\n\n",exec);
+  fprintf(output,"Convert a raw volume into a bricked volume with a per-brick min/max index.\n");
+  fprintf(output,"Given such a file, adaptive_threshold and talass_merge_tree only read and\n");
+  fprintf(output,"screen the bricks that may contain vertices above the threshold.\n\n");
+  fprintf(output,"--dtype <string>\n\tType of the input values (uint8 and uint16 are stored exactly, all others as float)\n");
+  fprintf(output,"--swap-bytes\n\tThe byte order of the input file differs from the host\n");
+  fprintf(output,"--offset <int>\n\tNumber of bytes to skip at the start of the input file\n");
+  fprintf(output,"--stride <int>\n\tNumber of interleaved values stored per voxel (default 1)\n");
+  fprintf(output,"--component <int>\n\tWhich of the interleaved values of each voxel to use (default 0)\n");
+  fprintf(output,"--brick-size <int>\n\tThe edge length of the bricks (default 32)\n");
+  fprintf(output,"--no-mmap\n\tRead the input into memory rather than memory mapping it\n");
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      gInputFileName = argv[++i];
+      break;
+    case 2: // --o
+      gOutputFileName = argv[++i];
+      break;
+    case 3: // --dim
+      gDim[0] = atoi(argv[++i]);
+      gDim[1] = atoi(argv[++i]);
+      gDim[2] = atoi(argv[++i]);
+      break;
+    case 4: // --dtype
+      i++;
+      if (parse_data_type(argv[i],gDataType) == 0) {
+        fprintf(stderr,"Sorry, the data type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 5: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 6: // --offset
+      gLayout.mOffset = strtoull(argv[++i],NULL,10);
+      break;
+    case 7: // --stride
+      gLayout.mStride = atoi(argv[++i]);
+      if (gLayout.mStride == 0) {
+        fprintf(stderr,"Sorry, the stride must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 8: // --component
+      gLayout.mComponent = atoi(argv[++i]);
+      break;
+    case 9: // --brick-size
+      gBrickSize = atoi(argv[++i]);
+      if (gBrickSize == 0) {
+        fprintf(stderr,"Sorry, the brick size must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 10: // --no-mmap
+      gUseMMap = false;
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0)
+      || (gInputFileName == NULL) || (gOutputFileName == NULL)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  InputVolume input;
+  if (input.read(gInputFileName,gDim,gDataType,gSwapBytes,gUseMMap,gLayout) == 0)
+    return 0;
+
+  // Small integer types are stored exactly using the identity mapping
+  // which keeps the counting sort available when reading the bricks
+  Quantizer identity;
+  if (data_type_domain(gDataType) > 0)
+    identity.mapping(8*data_type_size(gDataType),0,1);
+
+  BrickedWriter output(gDim,gBrickSize,(data_type_domain(gDataType) > 0) ? &identity : NULL,
+                       "data",-1,0,0);
+
+  if (output.open(gOutputFileName) == 0)
+    return 0;
+
+  GlobalIndexType plane = gDim[0]*gDim[1];
+  for (GlobalIndexType k=0;k<gDim[2];k++) {
+    if (output.writePlane(input.data() + k*plane,NULL) == 0)
+      return 0;
+  }
+
+  if (output.close() == 0)
+    return 0;
+
+  return 1;
+}
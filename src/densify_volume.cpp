@@ -0,0 +1,269 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Definitions.h"
+#include "Quantizer.h"
+#include "BrickedVolume.h"
+#include "SparseVolume.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 3
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--o",
+};
+
+//! Name of the input file
+const char* gInputFileName = NULL;
+
+//! Name of the output file
+const char* gOutputFileName = NULL;
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s --i <filename> [--o <filename>]\n\n",exec);
+  fprintf(output,"Expand a sparse, bricked, or quantized volume written by adaptive_threshold\n");
+  fprintf(output,"into a raw volume of floats written to the output file or stdout\n");
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      gInputFileName = argv[++i];
+      break;
+    case 2: // --o
+      gOutputFileName = argv[++i];
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+//! Expand a bricked volume
+int read_bricked_volume(const char* filename, std::vector<FunctionType>& volume, GlobalIndexType dim[3])
+{
+  BrickedReader reader;
+
+  if (reader.open(filename) == 0)
+    return 0;
+
+  const BrickedHeader& header = reader.header();
+  dim[0] = header.dim[0];
+  dim[1] = header.dim[1];
+  dim[2] = header.dim[2];
+
+  volume.resize(dim[0]*dim[1]*dim[2]);
+
+  int failed = 0;
+
+#pragma omp parallel for schedule(dynamic,1) reduction(+:failed)
+  for (int64_t b=0;b<(int64_t)reader.brickCount();b++) {
+    std::vector<FunctionType> values;
+    uint32_t low[3],high[3];
+    size_t k = 0;
+
+    if (reader.readBrick((uint32_t)b,values) == 0) {
+      failed++;
+      continue;
+    }
+
+    brick_box(header.dim,header.brickSize,(uint32_t)b,low,high);
+    for (uint32_t z=low[2];z<high[2];z++)
+      for (uint32_t y=low[1];y<high[1];y++)
+        for (uint32_t x=low[0];x<high[0];x++)
+          volume[(z*dim[1] + y)*dim[0] + x] = values[k++];
+  }
+
+  if (failed > 0) {
+    fprintf(stderr,"Error, could not read all bricks of \"%s\"\n",filename);
+    return 0;
+  }
+
+  return 1;
+}
+
+//! Expand a quantized raw volume
+int read_quantized_volume(const char* filename, std::vector<FunctionType>& volume, GlobalIndexType dim[3])
+{
+  char header[Quantizer::sHeaderSize];
+  Quantizer quantizer;
+
+  FILE* input = fopen(filename,"rb");
+  if ((input == NULL) || (fread(header,1,Quantizer::sHeaderSize,input) != Quantizer::sHeaderSize)
+      || (quantizer.parseHeader(header,dim) == 0)) {
+    fprintf(stderr,"Error, \"%s\" is not a quantized volume\n",filename);
+    if (input != NULL)
+      fclose(input);
+    return 0;
+  }
+
+  GlobalIndexType plane = dim[0]*dim[1];
+  std::vector<char> encoded(plane*quantizer.bytes());
+
+  volume.resize(plane*dim[2]);
+  for (GlobalIndexType k=0;k<dim[2];k++) {
+    if (fread(&encoded[0],quantizer.bytes(),plane,input) != plane) {
+      fprintf(stderr,"Error, quantized volume \"%s\" is truncated\n",filename);
+      fclose(input);
+      return 0;
+    }
+    quantizer.decode(&encoded[0],&volume[k*plane],plane);
+  }
+
+  fclose(input);
+
+  return 1;
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0) || (gInputFileName == NULL)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  // Determine the format from the identifier at the start of the file
+  char magic[4];
+  FILE* input = fopen(gInputFileName,"rb");
+  if ((input == NULL) || (fread(magic,1,4,input) != 4)) {
+    fprintf(stderr,"Error, could not read \"%s\"\n",gInputFileName);
+    return 0;
+  }
+  fclose(input);
+
+  std::vector<FunctionType> volume;
+  GlobalIndexType dim[3];
+  int success;
+
+  if (memcmp(magic,"ADSV",4) == 0)
+    success = read_sparse_volume(gInputFileName,volume,dim);
+  else if (memcmp(magic,"ADBV",4) == 0)
+    success = read_bricked_volume(gInputFileName,volume,dim);
+  else if (memcmp(magic,"ADQV",4) == 0)
+    success = read_quantized_volume(gInputFileName,volume,dim);
+  else {
+    fprintf(stderr,"Error, the format of \"%s\" is not recognized\n",gInputFileName);
+    return 0;
+  }
+
+  if (success == 0)
+    return 0;
+
+  fprintf(stderr,"Expanding a %llu x %llu x %llu volume\n",(unsigned long long)dim[0],
+          (unsigned long long)dim[1],(unsigned long long)dim[2]);
+
+  FILE* output = (gOutputFileName == NULL) ? stdout : fopen(gOutputFileName,"wb");
+  if (output == NULL) {
+    fprintf(stderr,"Error, could not open output file \"%s\"\n",gOutputFileName);
+    return 0;
+  }
+
+  // Write plane by plane as some systems do not handle very large writes
+  GlobalIndexType plane = dim[0]*dim[1];
+  for (GlobalIndexType k=0;k<dim[2];k++) {
+    if (fwrite(&volume[k*plane],sizeof(FunctionType),plane,output) != plane) {
+      fprintf(stderr,"Error, could not write the output\n");
+      return 0;
+    }
+  }
+
+  if (gOutputFileName != NULL)
+    fclose(output);
+
+  return 1;
+}
@@ -0,0 +1,181 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "Definitions.h"
+#include "SegmentationHierarchy.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 4
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--o",
+    "--level",
+};
+
+//! Name of the input file
+const char* gInputFileName = NULL;
+
+//! Name of the output file
+const char* gOutputFileName = NULL;
+
+//! The metric level of the segmentation
+FunctionType gLevel = 0;
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s --i <filename> --o <filename> --level <float>\n\n",exec);
+  fprintf(output,"Extract the segmentation of the given metric level from a segmentation hierarchy\n");
+  fprintf(output,"written by adaptive_threshold --hierarchy. The output is a raw uint32 volume\n");
+  fprintf(output,"containing for every voxel the lowest node of its feature or 4294967295 for voxels\n");
+  fprintf(output,"that are not part of any feature.\n\n");
+  fprintf(output,"--level <float>\n\tThe metric level (default 0)\n");
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      gInputFileName = argv[++i];
+      break;
+    case 2: // --o
+      gOutputFileName = argv[++i];
+      break;
+    case 3: // --level
+      gLevel = (FunctionType)atof(argv[++i]);
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0)
+      || (gInputFileName == NULL) || (gOutputFileName == NULL)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  SegmentationHierarchy hierarchy;
+  if (hierarchy.read(gInputFileName) == 0)
+    return 0;
+
+  const uint32_t* dim = hierarchy.dim();
+  GlobalIndexType count = (GlobalIndexType)dim[0]*dim[1]*dim[2];
+  std::vector<LocalIndexType> labels(count);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  hierarchy.segment(gLevel,labels.data());
+
+  fprintf(stderr,"Segmented %u x %u x %u voxels at %s level %g in %.3f s\n",dim[0],dim[1],dim[2],
+          hierarchy.metric(),gLevel,
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  FILE* output = fopen(gOutputFileName,"wb");
+  if (output == NULL) {
+    fprintf(stderr,"Error, could not open output file \"%s\"\n",gOutputFileName);
+    return 0;
+  }
+
+  if ((fwrite(labels.data(),sizeof(LocalIndexType),count,output) != count) || (fclose(output) != 0)) {
+    fprintf(stderr,"Error, could not write output file \"%s\"\n",gOutputFileName);
+    return 0;
+  }
+
+  return 1;
+}
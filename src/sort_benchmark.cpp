@@ -0,0 +1,252 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "Definitions.h"
+#include "DataType.h"
+#include "Comparisons.h"
+#include "MTAlgorithm.h"
+#include "InputVolume.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 8
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--dim",
+    "--dtype",
+    "--swap-bytes",
+
+    "--tree-type",
+    "--threshold",
+    "--repeat",
+};
+
+//! Name of the input file
+const char* gInputFileName = NULL;
+
+//! Global array of data (will point to gDim[0]*gDim[1]*gDim[2] values)
+thread_local const FunctionType* gData = NULL;
+
+//! Global array of dimensions
+thread_local GlobalIndexType gDim[3] = {0,0,0};
+
+//! The type of the values stored in the input file
+DataType gDataType = DATA_UINT16;
+
+//! Whether the byte order of the input file differs from the host
+bool gSwapBytes = false;
+
+//! Tree type 0 (merge tree), 1 (split tree)
+int gTreeType = 0;
+
+//! The threshold of the sort
+FunctionType gThreshold = 0;
+
+//! How often each sort is timed
+uint32_t gRepeat = 5;
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s --i <filename> --dim <int> <int> <int> [options]\n\n",exec);
+  fprintf(output,"Time the counting sort against the generic comparison sort on the vertices above the\n");
+  fprintf(output,"threshold of an 8 or 16 bit volume, check that both produce the same order and print\n");
+  fprintf(output,"the best and mean time of each to stdout.\n\n");
+  fprintf(output,"--dtype <string>\n\tType of the input values: uint8 or uint16 (default)\n");
+  fprintf(output,"--swap-bytes\n\tThe byte order of the input file differs from the host\n");
+  fprintf(output,"--tree-type [0 | 1]\n\tWhether to sort for a merge (0, default) or split tree (1)\n");
+  fprintf(output,"--threshold <float>\n\tOnly vertices above (merge tree) or below (split tree) are sorted (default 0)\n");
+  fprintf(output,"--repeat <int>\n\tHow often each sort is timed (default 5)\n");
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      gInputFileName = argv[++i];
+      break;
+    case 2: // --dim
+      gDim[0] = atoi(argv[++i]);
+      gDim[1] = atoi(argv[++i]);
+      gDim[2] = atoi(argv[++i]);
+      break;
+    case 3: // --dtype
+      i++;
+      if ((parse_data_type(argv[i],gDataType) == 0) || (data_type_domain(gDataType) == 0)) {
+        fprintf(stderr,"Sorry, the counting sort needs uint8 or uint16 input, not \"%s\" .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 4: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 5: // --tree-type
+      gTreeType = atoi(argv[++i]);
+      break;
+    case 6: // --threshold
+      gThreshold = (FunctionType)atof(argv[++i]);
+      break;
+    case 7: // --repeat
+      gRepeat = std::max(atoi(argv[++i]),1);
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+//! Time the given sort and return its order of the last run
+void time_sort(Comparison& greater, SortType sort, std::vector<LocalIndexType>& labels,
+               std::vector<GlobalIndexType>& order, double& best, double& mean)
+{
+  SweepOptions options;
+  FunctionType low;
+
+  options.mDomain = data_type_domain(gDataType);
+  options.mSort = sort;
+
+  best = 0;
+  mean = 0;
+
+  for (uint32_t r=0;r<gRepeat;r++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    sort_vertices(greater,gThreshold,&labels[0],options,order,low);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    best = (r == 0) ? seconds : std::min(best,seconds);
+    mean += seconds / gRepeat;
+  }
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0) || (gInputFileName == NULL)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+
+  InputVolume input;
+  if (input.read(gInputFileName,gDim,gDataType,gSwapBytes) == 0)
+    return 0;
+
+  gData = input.data();
+
+  std::vector<LocalIndexType> labels(gDim[0]*gDim[1]*gDim[2]);
+  std::vector<GlobalIndexType> generic,counting;
+  double generic_best,generic_mean,counting_best,counting_mean;
+
+  // The times include the screening which both sorts share
+  time_sort(greater,SORT_GENERIC,labels,generic,generic_best,generic_mean);
+  time_sort(greater,SORT_COUNTING,labels,counting,counting_best,counting_mean);
+
+  if (generic != counting) {
+    fprintf(stderr,"Error, the counting sort differs from the generic sort\n");
+    return 0;
+  }
+
+  fprintf(stdout,"vertices %zu\n",generic.size());
+  fprintf(stdout,"generic  best %.4f s mean %.4f s\n",generic_best,generic_mean);
+  fprintf(stdout,"counting best %.4f s mean %.4f s\n",counting_best,counting_mean);
+  fprintf(stdout,"speedup  %.2f\n",generic_best / counting_best);
+
+  return 1;
+}
@@ -0,0 +1,549 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "FullNeighborhood.h"
+#include "MTAlgorithm.h"
+#include "InputVolume.h"
+#include "BrickIndex.h"
+#include "VolumeOutput.h"
+#include "ThresholdSession.h"
+#include "Relevance.h"
+#include "R2.h"
+#include "Threshold.h"
+#include "LocalThreshold.h"
+
+//!Number of available input options (size of gOptions)
+#define NUM_OPTIONS 15
+
+//!Array with the list of all available input options
+static const char* gOptions[NUM_OPTIONS] = {
+    "--help",
+
+    "--i",
+    "--dim",
+    "--dtype",
+    "--swap-bytes",
+    "--offset",
+    "--stride",
+    "--component",
+    "--no-mmap",
+
+    "--tree-type",
+    "--threshold",
+    "--augmented",
+    "--sort",
+    "--summary-size",
+    "--metric",
+};
+
+//! Name of the input file
+const char* gInputFileName = NULL;
+
+//! Global array of data (will point to gDim[0]*gDim[1]*gDim[2] values)
+thread_local const FunctionType* gData = NULL;
+
+//! Global array of dimensions
+thread_local GlobalIndexType gDim[3] = {0,0,0};
+
+//! The type of the values stored in the input file
+DataType gDataType = DATA_FLOAT32;
+
+//! Whether the byte order of the input file differs from the host
+bool gSwapBytes = false;
+
+//! The location of the values within the input file
+InputLayout gLayout;
+
+//! Whether the input file should be memory mapped
+bool gUseMMap = true;
+
+//! Tree type 0 (merge tree), 1 (split tree)
+int gTreeType = 0;
+
+//! The lowest (merge tree) or highest (split tree) threshold of interest
+FunctionType gThreshold = 0;
+
+//! Whether the arcs store all vertices
+bool gAugmented = false;
+
+//! Number of sort types
+#define NUM_SORT_TYPES 3
+//! List of available sort types
+static const char* gSortTypeOptions[NUM_SORT_TYPES] = {
+    "auto",
+    "generic",
+    "counting",
+};
+//! The sort used to order the vertices
+SortType gSortType = SORT_AUTO;
+
+//! The brick size of the min/max summary used to skip empty space (0 to disable)
+uint32_t gSummarySize = 16;
+
+//! Number of metrics
+#define NUM_METRIC_TYPES 4
+//! List of available metrics
+static const char* gMetricTypeOptions[NUM_METRIC_TYPES] = {
+    "relevance",
+    "R2",
+    "threshold",
+    "local",
+};
+//! Enum of metrics
+enum MetricType {
+  METRIC_RELEVANCE = 0,
+  METRIC_R2 = 1,
+  METRIC_THRESHOLD = 2,
+  METRIC_LOCAL = 3,
+};
+//! The metric of the transformed volumes
+MetricType gMetric = METRIC_RELEVANCE;
+
+//! Create the given metric
+Metric* create_metric(MetricType type)
+{
+  switch (type) {
+    case METRIC_RELEVANCE:
+      return new Relevance();
+    case METRIC_R2:
+      return new R2();
+    case METRIC_THRESHOLD:
+      return new Threshold();
+    case METRIC_LOCAL:
+      return new LocalThreshold();
+  }
+
+  return NULL;
+}
+
+//! Find the metric with the given name
+int parse_metric(const char* name, MetricType& metric)
+{
+  for (int j=0; j < NUM_METRIC_TYPES;j++) {
+    if (strcmp(gMetricTypeOptions[j],name)==0) {
+      metric = (MetricType)j;
+      return 1;
+    }
+  }
+
+  fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",name);
+  return 0;
+}
+
+void print_usage(FILE* output, const char* exec)
+{
+  fprintf(output,"Usage: %s --i <filename> --dim <int> <int> <int> --threshold <float> [options]\n\n",exec);
+  fprintf(output,"Compute the merge tree once at the lowest threshold of interest and answer\n");
+  fprintf(output,"commands read from stdin for any higher threshold by restricting the tree.\n");
+  fprintf(output,"Neither the sort nor the sweep is repeated.\n\n");
+  fprintf(output,"--dtype <string>\n\tType of the input values: uint8, uint16, int32, float16, float32 (default), or double.\n\
+      \tValues are converted to float while loading (int32 and double may lose precision)\n");
+  fprintf(output,"--swap-bytes\n\tThe byte order of the input file differs from the host\n");
+  fprintf(output,"--offset <int>\n\tNumber of bytes to skip at the start of the input file\n");
+  fprintf(output,"--stride <int>\n\tNumber of interleaved values stored per voxel (default 1)\n");
+  fprintf(output,"--component <int>\n\tWhich of the interleaved values of each voxel to use (default 0)\n");
+  fprintf(output,"--no-mmap\n\tRead the input into memory rather than memory mapping it\n");
+  fprintf(output,"--tree-type [0 | 1]\n\tWhether to compute merge (0, default) or split tree (1)\n");
+  fprintf(output,"--threshold <float>\n\tThe lowest (merge tree) or highest (split tree) threshold of the session\n");
+  fprintf(output,"--augmented\n\tStore all vertices of the arcs which the R2 metric requires\n");
+  fprintf(output,"--sort <string>\n\tauto (default), generic or counting\n");
+  fprintf(output,"--summary-size <int>\n\tEdge length of the bricks of the min/max summary (default 16, 0 disables the summary)\n");
+  fprintf(output,"--metric <string>\n\tThe initial metric: relevance (default), R2, threshold or local\n\n");
+  fprintf(output,"Commands:\n");
+  fprintf(output,"threshold <float>\n\tRestrict the tree to the given threshold\n");
+  fprintf(output,"metric <string>\n\tSelect the metric of the transformed volumes\n");
+  fprintf(output,"transform <filename>\n\tWrite the transformed volume as raw floats\n");
+  fprintf(output,"features [<filename>]\n\tList the components above the threshold (root, x, y, z, maximum, size)\n\
+      \tordered by decreasing maximum to stdout or the given file\n");
+  fprintf(output,"feature <int> <int> <int>\n\tPrint the root of the feature containing the given voxel or -1\n");
+  fprintf(output,"update <filename> <int> <int> <int> <int> <int> <int>\n\tReplace the box [x0,x1)x[y0,y1)x[z0,z1) by the values of the given\n\
+      \tvolume and update the tree without a new sweep of the unchanged part\n");
+  fprintf(output,"info\n\tPrint the number of vertices and nodes above the threshold\n");
+  fprintf(output,"quit\n\tEnd the session\n");
+}
+
+/*! \brief Parse the command line input.
+ *
+ * \param argc : The number of input arguments. (As given to main(...)).
+ * \param argv : Array of lengths argc containing all input arguments.
+ *               (As given to main(...)).
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_command_line(int argc, const char** argv)
+{
+  int i,j,option;
+
+  for (i=1;i<argc;i++) {
+    option = -1;
+    for (j=0; j < NUM_OPTIONS;j++) {
+      if(strcmp(gOptions[j],argv[i])==0)
+        option= j;
+    }
+
+    switch (option) {
+
+    case -1:  // Wrong input parameter
+      fprintf(stderr,"\nError: Wrong input parameter \"%s\"\nTry %s --help\n\n",argv[i],argv[0]);
+      return 0;
+    case 0:   // --help
+      return 0;
+    case 1: // --i
+      gInputFileName = argv[++i];
+      break;
+    case 2: // --dim
+      gDim[0] = atoi(argv[++i]);
+      gDim[1] = atoi(argv[++i]);
+      gDim[2] = atoi(argv[++i]);
+      break;
+    case 3: // --dtype
+      i++;
+      if (parse_data_type(argv[i],gDataType) == 0) {
+        fprintf(stderr,"Sorry, the data type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 4: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 5: // --offset
+      gLayout.mOffset = strtoull(argv[++i],NULL,10);
+      break;
+    case 6: // --stride
+      gLayout.mStride = atoi(argv[++i]);
+      if (gLayout.mStride == 0) {
+        fprintf(stderr,"Sorry, the stride must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 7: // --component
+      gLayout.mComponent = atoi(argv[++i]);
+      break;
+    case 8: // --no-mmap
+      gUseMMap = false;
+      break;
+    case 9: // --tree-type
+      gTreeType = atoi(argv[++i]);
+      break;
+    case 10: // --threshold
+      gThreshold = (FunctionType)atof(argv[++i]);
+      break;
+    case 11: // --augmented
+      gAugmented = true;
+      break;
+    case 12: // --sort
+      i++;
+      for (j=0; j < NUM_SORT_TYPES;j++) {
+        if(strcmp(gSortTypeOptions[j],argv[i])==0) {
+          gSortType = (SortType)j;
+          break;
+        }
+      }
+      if (j == NUM_SORT_TYPES) {
+        fprintf(stderr,"Sorry, the sort type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 13: // --summary-size
+      gSummarySize = atoi(argv[++i]);
+      break;
+    case 14: // --metric
+      if (parse_metric(argv[++i],gMetric) == 0)
+        return 0;
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+//! Write the transformed volume of the current threshold plane by plane
+int write_transform(ThresholdSession& session, MetricType type, const char* filename)
+{
+  Metric* metric = create_metric(type);
+
+  if (session.prepare(*metric) == 0) {
+    delete metric;
+    return 0;
+  }
+
+  RawOutput output(gDim,NULL);
+  if (output.open(filename) == 0) {
+    delete metric;
+    return 0;
+  }
+
+  GlobalIndexType plane_size = gDim[0]*gDim[1];
+  std::vector<FunctionType> plane(plane_size);
+
+  for (GlobalIndexType k=0;k<gDim[2];k++) {
+    session.transform(*metric,k*plane_size,(k+1)*plane_size,&plane[0]);
+
+    if (output.writePlane(&plane[0],NULL) == 0) {
+      delete metric;
+      return 0;
+    }
+  }
+
+  delete metric;
+
+  return output.close();
+}
+
+//! List the components above the current threshold
+int write_features(const ThresholdSession& session, const char* filename)
+{
+  std::vector<SessionFeature> features;
+  FILE* output = stdout;
+
+  session.features(features);
+
+  if (filename != NULL) {
+    output = fopen(filename,"w");
+    if (output == NULL) {
+      fprintf(stderr,"Error, could not open feature file \"%s\"\n",filename);
+      return 0;
+    }
+  }
+
+  for (uint32_t i=0;i<features.size();i++) {
+    const SessionFeature& f = features[i];
+
+    fprintf(output,"%u %llu %llu %llu %g %llu\n",f.root,
+            (unsigned long long)(f.index % gDim[0]),
+            (unsigned long long)((f.index / gDim[0]) % gDim[1]),
+            (unsigned long long)(f.index / (gDim[0]*gDim[1])),
+            f.maximum,(unsigned long long)f.size);
+  }
+
+  if (filename != NULL)
+    fclose(output);
+  else
+    fflush(output);
+
+  return 1;
+}
+
+//! Replace the values of the box [low,high) by those of the given file and update the session
+int update_region(ThresholdSession& session, Neighborhood& neighborhood, const char* filename,
+                  const GlobalIndexType low[3], const GlobalIndexType high[3],
+                  std::vector<FunctionType>& values)
+{
+  InputVolume region;
+  GlobalIndexType x,y,z;
+  std::vector<FunctionType> previous;
+
+  if (region.readRegion(filename,gDim,low,high,gDataType,gSwapBytes,gLayout) == 0)
+    return 0;
+
+  // The input may be mapped read-only so the first update makes a copy
+  if (values.empty())
+    values.assign(gData,gData + gDim[0]*gDim[1]*gDim[2]);
+
+  // The session locates the change in its order by the previous values
+  const FunctionType* source = region.data();
+  previous.reserve((high[0] - low[0])*(high[1] - low[1])*(high[2] - low[2]));
+  for (z=low[2];z<high[2];z++) {
+    for (y=low[1];y<high[1];y++) {
+      for (x=low[0];x<high[0];x++) {
+        previous.push_back(values[(z*gDim[1] + y)*gDim[0] + x]);
+        values[(z*gDim[1] + y)*gDim[0] + x] = *source++;
+      }
+    }
+  }
+
+  gData = &values[0];
+
+  return session.update(neighborhood,low,high,&previous[0]);
+}
+
+int main(int argc, const char** argv)
+{
+  if ((argc == 1) || (parse_command_line(argc,argv) == 0) || (gInputFileName == NULL)) {
+    print_usage(stdout,argv[0]);
+    return 0;
+  }
+
+  if ((gMetric == METRIC_R2) && !gAugmented) {
+    fprintf(stderr,"The R2 metric needs augmented arcs, enabling --augmented\n");
+    gAugmented = true;
+  }
+
+  // The comparison defining the tree type
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+
+  InputVolume input;
+  if (input.read(gInputFileName,gDim,gDataType,gSwapBytes,gUseMMap,gLayout) == 0)
+    return 0;
+
+  gData = input.data();
+
+  BrickIndex bricks;
+  if (gSummarySize > 0)
+    bricks.build(gData,gDim,gSummarySize);
+
+  FullNeighborhood neighborhood(gDim);
+
+  SweepOptions options;
+  options.mDomain = data_type_domain(gDataType);
+  options.mSort = gSortType;
+  options.mBricks = bricks.empty() ? NULL : &bricks;
+
+  ThresholdSession session(greater);
+
+  if (session.initialize(neighborhood,gThreshold,gAugmented,options) == 0)
+    return 0;
+
+  fprintf(stderr,"Session ready at threshold %f with %u nodes\n",gThreshold,session.tree().size());
+
+  // The data of the session once it has been updated
+  std::vector<FunctionType> values;
+
+  char line[1024];
+  char command[64];
+  char argument[1024];
+
+  while (fgets(line,sizeof(line),stdin) != NULL) {
+    int count = sscanf(line,"%63s %1023s",command,argument);
+
+    if (count < 1)
+      continue;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int status = 1;
+
+    if (strcmp(command,"quit") == 0)
+      break;
+    else if ((strcmp(command,"threshold") == 0) && (count == 2))
+      status = session.threshold((FunctionType)atof(argument));
+    else if ((strcmp(command,"metric") == 0) && (count == 2)) {
+      MetricType metric;
+      status = parse_metric(argument,metric);
+
+      if ((status == 1) && (metric == METRIC_R2) && !gAugmented) {
+        fprintf(stderr,"Error, the R2 metric needs a session started with --augmented\n");
+        status = 0;
+      }
+      else if (status == 1)
+        gMetric = metric;
+    }
+    else if ((strcmp(command,"transform") == 0) && (count == 2))
+      status = write_transform(session,gMetric,argument);
+    else if (strcmp(command,"features") == 0)
+      status = write_features(session,(count == 2) ? argument : NULL);
+    else if (strcmp(command,"feature") == 0) {
+      unsigned long long p[3];
+
+      if ((sscanf(line,"%*s %llu %llu %llu",p,p+1,p+2) == 3)
+          && (p[0] < gDim[0]) && (p[1] < gDim[1]) && (p[2] < gDim[2])) {
+        LocalIndexType f = session.feature((p[2]*gDim[1] + p[1])*gDim[0] + p[0]);
+        fprintf(stdout,"feature %d\n",(f == LNULL) ? -1 : (int)f);
+      }
+      else {
+        fprintf(stderr,"Error, the feature command needs a voxel inside the volume\n");
+        status = 0;
+      }
+    }
+    else if ((strcmp(command,"update") == 0) && (count == 2)) {
+      unsigned long long b[6];
+      GlobalIndexType low[3],high[3];
+
+      if ((sscanf(line,"%*s %*s %llu %llu %llu %llu %llu %llu",b,b+1,b+2,b+3,b+4,b+5) == 6)
+          && (b[0] < b[3]) && (b[1] < b[4]) && (b[2] < b[5])
+          && (b[3] <= gDim[0]) && (b[4] <= gDim[1]) && (b[5] <= gDim[2])) {
+        for (int k=0;k<3;k++) {
+          low[k] = b[k];
+          high[k] = b[k+3];
+        }
+        status = update_region(session,neighborhood,argument,low,high,values);
+      }
+      else {
+        fprintf(stderr,"Error, the update command needs a non-empty box inside the volume\n");
+        status = 0;
+      }
+    }
+    else if (strcmp(command,"info") == 0)
+      fprintf(stdout,"threshold %g vertices %llu nodes %u\n",session.threshold(),
+              (unsigned long long)session.vertexCount(),session.nodeCount());
+    else {
+      fprintf(stderr,"Error, unknown command \"%s\"\n",line);
+      status = 0;
+    }
+
+    fprintf(stderr,"%s %s after %.3f s\n",command,(status == 1) ? "done" : "failed",
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    fflush(stdout);
+  }
+
+  return 1;
+}
@@ -66,6 +66,9 @@
 #include <cstring>
 #include <stack>
 #include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 
 #include "Definitions.h"
@@ -73,9 +76,15 @@
 #include "FullNeighborhood.h"
 #include "MergeTree.h"
 #include "MTAlgorithm.h"
+#include "InputVolume.h"
+#include "TreeCache.h"
+#include "BrickedVolume.h"
 #include "Relevance.h"
 #include "LocalThreshold.h"
 #include "Threshold.h"
+#include "R2.h"
+#include "FeatureAttributes.h"
+#include "PersistenceDiagram.h"
 #include "ManPage.h"
 
 #include "TopologyFileParser/DataHandle.h"
@@ -86,7 +95,7 @@
 #include "TopologyFileParser/SimplificationHandle.h"
 
 //!Number of available input options (size of gOptions)1
-#define NUM_OPTIONS 9
+#define NUM_OPTIONS 25
 
 //!Array with the list of all available input options
 static const char* gOptions[NUM_OPTIONS] = {
@@ -102,19 +111,86 @@ static const char* gOptions[NUM_OPTIONS] = {
     "--split-type",
     "--split",
     "--metric",
+    "--no-mmap",
+    "--dtype",
+    "--swap-bytes",
+    "--sort",
+    "--roi",
+    "--roi-output",
+    "--offset",
+    "--stride",
+    "--component",
+    "--summary-size",
+    "--tree-cache",
+    "--simplify",
+    "--simplify-size",
+    "--persistence",
+    "--betti",
+    "--threshold-quantile",
 };
 
 //! Name of the input file
 const char* gInputFileName = NULL;
 
+//! Name of the optional tree cache
+const char* gTreeCacheName = NULL;
+
 //! Name of the output file
 const char* gOutputFileName = "output";
 
-//! Global array of data (will be allocated to gDim[0]*gDim[1]*gDim[2]
-FunctionType* gData = NULL;
+//! Global array of data (will point to gDim[0]*gDim[1]*gDim[2] values)
+thread_local const FunctionType* gData = NULL;
+
+//! Whether the input file should be memory mapped
+bool gUseMMap = true;
+
+//! The type of the values stored in the input file
+DataType gDataType = DATA_FLOAT32;
+
+//! Whether the byte order of the input file differs from the host
+bool gSwapBytes = false;
+
+//! The location of the values within the input file
+InputLayout gLayout;
+
+//! The brick size of the min/max summary used to skip empty space (0 to disable)
+uint32_t gSummarySize = 16;
+
+//! Number of sort types
+#define NUM_SORT_TYPES 3
+//! List of available sort types
+static const char* gSortTypeOptions[NUM_SORT_TYPES] = {
+    "auto",
+    "generic",
+    "counting",
+};
+//! The sort used to order the vertices
+SortType gSortType = SORT_AUTO;
 
 //! Global array of dimensions
-GlobalIndexType gDim[3] = {0,0,0};
+thread_local GlobalIndexType gDim[3] = {0,0,0};
+
+//! Dimensions of the full volume stored in the input file
+GlobalIndexType gFullDim[3] = {0,0,0};
+
+//! The lower corner of the region of interest
+GlobalIndexType gROILow[3] = {0,0,0};
+
+//! The upper corner (exclusive) of the region of interest
+GlobalIndexType gROIHigh[3] = {0,0,0};
+
+//! Bool to indicate whether a region of interest has been set
+bool gROISet = false;
+
+//! Number of region of interest output modes
+#define NUM_ROI_OUTPUT_TYPES 2
+//! List of available region of interest output modes
+static const char* gROIOutputOptions[NUM_ROI_OUTPUT_TYPES] = {
+    "crop",
+    "full",
+};
+//! Whether the segmentation refers to the full volume rather than the region
+bool gROIFullOutput = false;
 
 //! Tree type 0 (merge tree), 1 (split tree)
 int gTreeType = 0;
@@ -125,6 +201,9 @@ FunctionType gThreshold = 0;
 //! Bool to indicate whether the threshold has been set
 bool gThresholdSet = false;
 
+//! Fraction of the vertices to keep or a negative value to use gThreshold
+double gThresholdQuantile = -1;
+
 //! Number of different split types
 #define NUM_SPLIT_TYPES 2
 //! List of available split types
@@ -144,75 +223,97 @@ SplitType gSplitType = SPLIT_LENGTH;
 //! The splitting threshold
 FunctionType gSplitLimit = -1;
 
+//! Name of the optional persistence diagram file
+const char* gPersistenceFileName = NULL;
+
+//! Name of the optional component count curve file
+const char* gBettiFileName = NULL;
+
+//! Cancel branches whose persistence is smaller than this (0 to disable)
+FunctionType gSimplifyPersistence = 0;
+
+//! Cancel branches with fewer vertices than this (0 to disable)
+GlobalIndexType gSimplifySize = 0;
+
 //! Number of metrics
-#define NUM_METRIC_TYPES 3
+#define NUM_METRIC_TYPES 4
 //! List of available metrics
 static const char* gMetricTypeOptions[NUM_METRIC_TYPES] = {
     "threshold",
     "relevance",
     "local",
+    "R2",
+};
+//! The names of the metrics stored in the family
+static const char* gMetricNames[NUM_METRIC_TYPES] = {
+    "Threshold",
+    "Relevance",
+    "LocalThreshold",
+    "R2",
 };
 //! Enum of metrics
 enum MetricType {
   METRIC_THRESHOLD = 0,
   METRIC_RELEVANCE = 1,
   METRIC_LOCAL = 2,
+  METRIC_R2 = 3,
 };
-//! The metric used
-MetricType gMetric = METRIC_THRESHOLD;
-
-using namespace TopologyFileFormat;
-
+//! The metrics computed (one simplification sequence each)
+std::vector<MetricType> gMetrics;
 
-void accumulateVolume(const MergeTree& tree, LocalIndexType root, Data<uint64_t>& data)
+/*! \brief Parse a comma separated list of metric names
+ *
+ * \param list : The list of names
+ * \param metrics : The vector the metrics are appended to
+ * \return int : 0 in case of error and 1 in case of successs
+ */
+int parse_metric_list(const char* list, std::vector<MetricType>& metrics)
 {
-  std::stack<LocalIndexType> front;
-  LocalIndexType top;
-  std::set<LocalIndexType> processed;
-
-  front.push(root);
-
-  while (!front.empty()) {
-
-    top = front.top();
-
-    // If this is the first time we see this node
-    if (processed.find(top) == processed.end()) {
-
-      LocalIndexType up = tree.node(top).up();
-
-      if (up == LNULL) {// If this is a leaf the volume it correct
-        front.pop(); // and there is nothing to do
-      }
-      else { // Otherwise
-
-        do { // add all the children
-          front.push(up);
-          up = tree.node(up).next();
-        } while (up != tree.node(top).up());
-
-        // Remember that we are done with this node
-        processed.insert(top);
+  std::string names(list);
+  size_t start = 0;
+  int j;
+
+  while (start <= names.size()) {
+    size_t end = std::min(names.find(',',start),names.size());
+    std::string name = names.substr(start,end - start);
+
+    for (j=0; j < NUM_METRIC_TYPES;j++) {
+      if (name == gMetricTypeOptions[j]) {
+        if (std::find(metrics.begin(),metrics.end(),(MetricType)j) == metrics.end())
+          metrics.push_back((MetricType)j);
+        break;
       }
     }
-    else { // If we have already processed this node then the volume of my children is correct
-
-      assert (tree.node(top).up() != LNULL); // We should not get here for a leaf
+    if (j == NUM_METRIC_TYPES) {
+      fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",name.c_str());
+      return 0;
+    }
 
-      LocalIndexType up = tree.node(top).up();
-      do { // add the volume from all children
+    start = end + 1;
+  }
 
-        data[top] += data[up];
-        up = tree.node(up).next();
-      } while (up != tree.node(top).up());
+  return 1;
+}
 
-      front.pop();
-    }
+//! Create the given metric
+Metric* create_metric(MetricType type)
+{
+  switch (type) {
+    case METRIC_THRESHOLD:
+      return new Threshold();
+    case METRIC_RELEVANCE:
+      return new Relevance();
+    case METRIC_LOCAL:
+      return new LocalThreshold();
+    case METRIC_R2:
+      return new R2();
   }
 
-  return;
+  return NULL;
 }
 
+using namespace TopologyFileFormat;
+
 
 /*! \brief Parse the command line input.
  *
@@ -278,15 +379,90 @@ int parse_command_line(int argc, const char** argv)
       gSplitLimit = (FunctionType)atof(argv[++i]);
       break;
     case 8: // --metric
+      if (parse_metric_list(argv[++i],gMetrics) == 0)
+        return 0;
+      break;
+    case 9: // --no-mmap
+      gUseMMap = false;
+      break;
+    case 10: // --dtype
       i++;
-      for (j=0; j < NUM_METRIC_TYPES;j++) {
-        if(strcmp(gMetricTypeOptions[j],argv[i])==0) {
-          gMetric = (MetricType)j;
+      if (parse_data_type(argv[i],gDataType) == 0) {
+        fprintf(stderr,"Sorry, the data type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 11: // --swap-bytes
+      gSwapBytes = true;
+      break;
+    case 12: // --sort
+      i++;
+      for (j=0; j < NUM_SORT_TYPES;j++) {
+        if(strcmp(gSortTypeOptions[j],argv[i])==0) {
+          gSortType = (SortType)j;
+          break;
+        }
+      }
+      if (j == NUM_SORT_TYPES) {
+        fprintf(stderr,"Sorry, the sort type \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 13: // --roi
+      for (j=0;j<3;j++)
+        gROILow[j] = atoi(argv[++i]);
+      for (j=0;j<3;j++)
+        gROIHigh[j] = atoi(argv[++i]);
+      gROISet = true;
+      break;
+    case 14: // --roi-output
+      i++;
+      for (j=0; j < NUM_ROI_OUTPUT_TYPES;j++) {
+        if(strcmp(gROIOutputOptions[j],argv[i])==0) {
+          gROIFullOutput = (j == 1);
           break;
         }
       }
-      if (j == NUM_METRIC_TYPES) {
-        fprintf(stderr,"Sorry, the metric type \"%s\"is not recognized .....\n",argv[i]);
+      if (j == NUM_ROI_OUTPUT_TYPES) {
+        fprintf(stderr,"Sorry, the region output \"%s\"is not recognized .....\n",argv[i]);
+        return 0;
+      }
+      break;
+    case 15: // --offset
+      gLayout.mOffset = strtoull(argv[++i],NULL,10);
+      break;
+    case 16: // --stride
+      gLayout.mStride = atoi(argv[++i]);
+      if (gLayout.mStride == 0) {
+        fprintf(stderr,"Sorry, the stride must be positive .....\n");
+        return 0;
+      }
+      break;
+    case 17: // --component
+      gLayout.mComponent = atoi(argv[++i]);
+      break;
+    case 18: // --summary-size
+      gSummarySize = atoi(argv[++i]);
+      break;
+    case 19: // --tree-cache
+      gTreeCacheName = argv[++i];
+      break;
+    case 20: // --simplify
+      gSimplifyPersistence = (FunctionType)atof(argv[++i]);
+      break;
+    case 21: // --simplify-size
+      gSimplifySize = strtoull(argv[++i],NULL,10);
+      break;
+    case 22: // --persistence
+      gPersistenceFileName = argv[++i];
+      break;
+    case 23: // --betti
+      gBettiFileName = argv[++i];
+      break;
+    case 24: // --threshold-quantile
+      gThresholdQuantile = atof(argv[++i]);
+      if ((gThresholdQuantile < 0) || (gThresholdQuantile > 1)) {
+        fprintf(stderr,"Sorry, the quantile must lie in [0,1] .....\n");
         return 0;
       }
       break;
@@ -306,60 +482,168 @@ int main(int argc, const char** argv)
     return 0;
   }
 
-  GlobalIndexType size = gDim[0]*gDim[1]*gDim[2];
+  if (gInputFileName == NULL) {
+    fprintf(stderr,"Error, no input filename given\n");
+    return 0;
+  }
 
+  // The comparison defining the tree type
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+  Comparison& greater = (gTreeType == 0) ? (Comparison&)merge_comp : (Comparison&)split_comp;
+
+  // Map (or read) the input data
+  InputVolume input;
+  BrickIndex bricks;
+  bool bricked = is_bricked_volume(gInputFileName);
+
+  // Bricked input describes itself and only bricks that may contain
+  // vertices above the threshold are read
+  if (bricked) {
+    if (gROISet) {
+      fprintf(stderr,"Error, a region of interest is not supported for bricked input\n");
+      return 0;
+    }
 
-  Metric* metric = NULL;
-  switch (gMetric) {
-    case METRIC_THRESHOLD: {
-      metric = new Threshold();
-      break;
+    if (gThresholdQuantile >= 0) {
+      fprintf(stderr,"Error, a quantile threshold is not supported for bricked input\n");
+      return 0;
     }
-    case METRIC_RELEVANCE: {
-      metric = new Relevance();
-      break;
+
+    if (input.readBricked(gInputFileName,greater,gThreshold,gDim,bricks,gDataType) == 0)
+      return 0;
+  }
+
+  // From here on gDim refers to the region that is processed and
+  // gFullDim to the volume stored in the file
+  gFullDim[0] = gDim[0];
+  gFullDim[1] = gDim[1];
+  gFullDim[2] = gDim[2];
+
+  if (gROISet) {
+    for (int i=0;i<3;i++) {
+      if ((gROILow[i] >= gROIHigh[i]) || (gROIHigh[i] > gFullDim[i])) {
+        fprintf(stderr,"Error, the region of interest must be non-empty and inside the volume\n");
+        return 0;
+      }
+      gDim[i] = gROIHigh[i] - gROILow[i];
     }
-    case METRIC_LOCAL: {
-      metric = new LocalThreshold();
-      break;
+  }
+  else
+    gROIFullOutput = false;
+
+  if (!bricked) {
+    if (gROISet) {
+      if (input.readRegion(gInputFileName,gFullDim,gROILow,gROIHigh,gDataType,gSwapBytes,gLayout) == 0)
+        return 0;
     }
-    default:
-      fprintf(stderr,"Error, unkonwn metric\n");
+    else if (input.read(gInputFileName,gDim,gDataType,gSwapBytes,gUseMMap,gLayout) == 0)
       return 0;
   }
 
+  gData = input.data();
 
+  // The histogram that finds the cutoff also counts the vertices above it
+  GlobalIndexType expected = 0;
 
-  gData = new FunctionType[size];
-  LocalIndexType* labels = new LocalIndexType[size];
+  if (gThresholdQuantile >= 0) {
+    gThreshold = quantile_threshold(gData,gDim[0]*gDim[1]*gDim[2],greater,gThresholdQuantile,expected);
 
-  FILE* input = NULL;
-  if (gInputFileName != NULL)
-    input = fopen(gInputFileName,"rb");
-  else {
-    fprintf(stderr,"Error, no input filename given\n");
-    return 0;
+    fprintf(stderr,"Using threshold %g keeping %llu vertices (quantile %g)\n",gThreshold,
+            (unsigned long long)expected,gThresholdQuantile);
   }
 
+  // Summarize the data so that empty space can be skipped for any threshold
+  if (!bricked && (gSummarySize > 0))
+    bricks.build(gData,gDim,gSummarySize);
+
+  GlobalIndexType size = gDim[0]*gDim[1]*gDim[2];
 
-  // Some systems do not gracefully handle very large files so we read
-  // things by plane instead
-  for (int i=0;i<gDim[2];i++)
-    fread(gData+i*gDim[0]*gDim[1],sizeof(FunctionType),gDim[0]*gDim[1],input);
-  fclose(input);
 
+  if (gMetrics.empty())
+    gMetrics.push_back(METRIC_THRESHOLD);
+
+  std::vector<Metric*> metrics(gMetrics.size());
+  for (uint32_t m=0;m<metrics.size();m++)
+    metrics[m] = create_metric(gMetrics[m]);
 
   MergeTree tree;
   FullNeighborhood neighborhood(gDim);
-  bool augmented = metric->explicitArcs();
 
-  if (gTreeType == 0) {
-    MergeTreeComp comp;
-    merge_tree_sorted_sweep(comp,neighborhood,gThreshold,tree,true,labels);
-  }
+  SweepOptions options;
+  options.mDomain = data_type_domain(gDataType);
+  options.mSort = gSortType;
+  options.mBricks = bricks.empty() ? NULL : &bricks;
+  options.mReserve = expected;
+
+  // Restore the tree and labels from the cache if possible and otherwise
+  // sweep and fill the cache for the next run
+  TreeCache cache;
+  LocalIndexType* label_buffer = NULL;
+  const LocalIndexType* labels = NULL;
+
+  if ((gTreeCacheName != NULL)
+      && (cache.key(gInputFileName,gDim,gROILow,gDataType,gSwapBytes,gLayout,gThreshold,gTreeType,
+                    neighborhood.size()) == 0))
+    return 0;
+
+  if ((gTreeCacheName != NULL) && (cache.load(gTreeCacheName,true,tree) == 1))
+    labels = cache.labels();
   else {
-    SplitTreeComp comp;
-    merge_tree_sorted_sweep(comp,neighborhood,gThreshold,tree,true,labels);
+    label_buffer = new LocalIndexType[size];
+    labels = label_buffer;
+
+    merge_tree_sorted_sweep(greater,neighborhood,gThreshold,tree,true,label_buffer,options);
+
+    if (gTreeCacheName != NULL)
+      cache.save(gTreeCacheName,true,tree,labels,size);
+  }
+
+  // Cancel the noise branches before splitting and evaluating any metric
+  if ((gSimplifyPersistence > 0) || (gSimplifySize > 0)) {
+    std::vector<GlobalIndexType> sizes;
+    std::vector<LocalIndexType> map;
+    LocalIndexType nodes = tree.size();
+
+    if (gSimplifySize > 0)
+      count_labels(labels,size,tree.size(),sizes);
+
+    tree.simplify(greater,gSimplifyPersistence,gSimplifySize,sizes,map);
+
+    // Labels restored from the cache are read-only
+    if (label_buffer == NULL) {
+      label_buffer = new LocalIndexType[size];
+      std::copy(labels,labels + size,label_buffer);
+      labels = label_buffer;
+    }
+    relabel_vertices(label_buffer,size,map);
+
+    fprintf(stderr,"Simplified the tree from %u to %u nodes\n",nodes,tree.size());
+  }
+
+  // Export the persistence diagram and component counts of the tree
+  if ((gPersistenceFileName != NULL) || (gBettiFileName != NULL)) {
+    PersistenceDiagram diagram;
+    const char* names[2] = {gPersistenceFileName,gBettiFileName};
+
+    diagram.compute(tree,gData,greater,gThreshold);
+
+    for (int k=0;k<2;k++) {
+      if (names[k] == NULL)
+        continue;
+
+      FILE* output = fopen(names[k],"w");
+      if (output == NULL) {
+        fprintf(stderr,"Error, could not open \"%s\"\n",names[k]);
+        return 0;
+      }
+
+      if (k == 0)
+        diagram.writePairs(output);
+      else
+        diagram.writeCurve(output);
+      fclose(output);
+    }
   }
 
   LocalIndexType label;
@@ -403,128 +687,116 @@ int main(int argc, const char** argv)
   }
 
 
-  metric->initialize(gData,&tree);
-
-  // Evaluate the metric on all critical points
-  for (LocalIndexType i=0;i<tree.size();i++)
-    tree.node(i).metric(metric->eval(tree.node(i).index(),i));
+  // Compute the per-feature statistics in a single pass over the arcs
+  // and accumulate them through the tree
+  FeatureAttributes attributes;
+  attributes.computeFromArcs(tree,gData,gDim);
+  attributes.accumulate(tree);
 
-
-  // Compute the volume
   Data<uint64_t> volume(tree.size());
-  for (LocalIndexType i=0;i<tree.size();i++)
-    volume[i] = tree.arc(i).size();
+  Data<FunctionType> mean(tree.size());
+  Data<FunctionType> variance(tree.size());
+  Data<FunctionType> minimum(tree.size());
+  Data<FunctionType> maximum(tree.size());
 
-  // Accumulate the volume through the tree
   for (LocalIndexType i=0;i<tree.size();i++) {
-
-    if (tree.node(i).down() == LNULL)  // For all roots
-      accumulateVolume(tree,i,volume);
+    volume[i] = attributes.subtree(i).mCount;
+    mean[i] = (FunctionType)attributes.subtree(i).mMean;
+    variance[i] = (FunctionType)attributes.subtree(i).variance();
+    minimum[i] = attributes.subtree(i).mMin;
+    maximum[i] = attributes.subtree(i).mMax;
   }
 
 
 
 
+  fprintf(stderr,"GlobalIndexType %d ... LocalIndexType  %d \n",sizeof(GlobalIndexType),sizeof(LocalIndexType));
 
-  // Prepare the output
-  GlobalIndexType progress = 0;
-  GlobalIndexType next = 0;
-
-  FILE* output;
-
+  // Create a handle to a family
+  ClanHandle clan;
+  FamilyHandle family;
 
-  FeatureElementData features;
+  // Set the overall function range of the clan
+  family.range(tree.minimum(),tree.maximum());
 
+  // Name the attribute
+  family.variableName("Attribute0");
 
-  FunctionType life[2];
-  FunctionType low,high;
+  // The tree and its attributes are shared and each metric adds its own
+  // simplification sequence to the family
+  std::vector<FeatureElementData> features(metrics.size());
 
-  // Initialize the bounds
-  low = 10e20;
-  high = -10e20;
+  for (uint32_t m=0;m<metrics.size();m++) {
+    metrics[m]->initialize(gData,&tree);
 
-  // Create enough FeatureElements
-  features.resize(tree.size(),FeatureElement(SINGLE_REPRESENTATIVE));
+    // Evaluate the metric on all critical points
+    if (metrics[m]->explicitArcs())
+      metrics[m]->eval(tree);
+    else {
+      for (LocalIndexType i=0;i<tree.size();i++)
+        tree.node(i).metric(metrics[m]->eval(tree.node(i).index(),i));
+    }
 
+    FunctionType life[2];
+    FunctionType low,high;
 
-  for (LocalIndexType i=0;i<tree.size();i++) {
+    // Initialize the bounds
+    low = 10e20;
+    high = -10e20;
 
-    life[1] = tree.node(i).metric();
-    if (tree.node(i).down() == LNULL) { // local minimum
-      life[0] = tree.node(i).metric();
-    }
-    else
-      life[0] = tree.node(tree.node(i).down()).metric();
+    // Create enough FeatureElements
+    features[m].resize(tree.size(),FeatureElement(SINGLE_REPRESENTATIVE));
 
+    for (LocalIndexType i=0;i<tree.size();i++) {
 
-    if (life[0] > life[1])
-      std::swap(life[0],life[1]);
+      life[1] = tree.node(i).metric();
+      if (tree.node(i).down() == LNULL) { // local minimum
+        life[0] = tree.node(i).metric();
+      }
+      else
+        life[0] = tree.node(tree.node(i).down()).metric();
 
-    features[i].addLink(tree.node(i).down());
 
+      if (life[0] > life[1])
+        std::swap(life[0],life[1]);
 
-    if (gTreeType == 0)
-      features[i].direction(0);
-    else
-      features[i].direction(1);
+      features[m][i].addLink(tree.node(i).down());
 
 
-    features[i].lifeTime(life[0],life[1]);
+      if (gTreeType == 0)
+        features[m][i].direction(0);
+      else
+        features[m][i].direction(1);
 
-    low = std::min(low,life[0]);
-    high = std::max(high,life[1]);
-  }
 
-  fprintf(stderr,"GlobalIndexType %d ... LocalIndexType  %d \n",sizeof(GlobalIndexType),sizeof(LocalIndexType));
+      features[m][i].lifeTime(life[0],life[1]);
 
-  // Create a handle to a family
-  ClanHandle clan;
-  FamilyHandle family;
+      low = std::min(low,life[0]);
+      high = std::max(high,life[1]);
+    }
 
-  // Set the overall function range of the clan
-  family.range(tree.minimum(),tree.maximum());
+    // Now assemble the simplification sequence
+    SimplificationHandle simp;
 
-  // Name the attribute
-  family.variableName("Attribute0");
+    // Set the features as data from the simplification handle
+    simp.setData(&features[m]);
 
-  // Now assemble the simplification sequence
-  SimplificationHandle simp;
-  FunctionType range[2];
+    // Set the range
+    simp.setRange(low,high);
 
-  // Set the features as data from the simplification handle
-  simp.setData(&features);
+    // For the moment we assume that we have merge or split trees in which case we
+    // always only have a single represetative
+    simp.fileType(SINGLE_REPRESENTATIVE);
 
-  // Set the range
-  simp.setRange(low,high);
+    simp.metric(gMetricNames[gMetrics[m]]);
 
-  // For the moment we assume that we have merge or split trees in which case we
-  // always only have a single represetative
-  simp.fileType(SINGLE_REPRESENTATIVE);
+    // Set the encoding
+    simp.encoding(false);
 
-  switch (gMetric) {
-    case METRIC_THRESHOLD: {
-      simp.metric("Threshold");
-      break;
-    }
-    case METRIC_RELEVANCE: {
-      simp.metric("Relevance");
-      break;
-    }
-    case METRIC_LOCAL: {
-      simp.metric("LocalThreshold");
-      break;
-    }
-    default:
-      fprintf(stderr,"Error, unkonwn metric\n");
-      return 0;
+    // Add the simplification handle to the family
+    family.add(simp);
   }
 
-  // Set the encoding
-  simp.encoding(false);
-
-  // Add the simplification handle to the family
-  family.add(simp);
-
 
   // Create the volume handle
   StatHandle volume_handle;
@@ -538,6 +810,39 @@ int main(int argc, const char** argv)
 
   family.add(volume_handle);
 
+  // Create the handles for the remaining statistics
+  StatHandle mean_handle;
+  mean_handle.aggregated(true);
+  mean_handle.stat("mean");
+  mean_handle.species("xray");
+  mean_handle.encoding(false);
+  mean_handle.setData(&mean);
+  family.add(mean_handle);
+
+  StatHandle variance_handle;
+  variance_handle.aggregated(true);
+  variance_handle.stat("variance");
+  variance_handle.species("xray");
+  variance_handle.encoding(false);
+  variance_handle.setData(&variance);
+  family.add(variance_handle);
+
+  StatHandle min_handle;
+  min_handle.aggregated(true);
+  min_handle.stat("min");
+  min_handle.species("xray");
+  min_handle.encoding(false);
+  min_handle.setData(&minimum);
+  family.add(min_handle);
+
+  StatHandle max_handle;
+  max_handle.aggregated(true);
+  max_handle.stat("max");
+  max_handle.species("xray");
+  max_handle.encoding(false);
+  max_handle.setData(&maximum);
+  family.add(max_handle);
+
 
 
   // Finally, we attach the family to the clan
@@ -564,17 +869,39 @@ int main(int argc, const char** argv)
   seg_handle.domainType(REGULAR_GRID);
 
   char descriptor[100];
-  sprintf(descriptor,"3 %d %d %d",gDim[0],gDim[1],gDim[2]);
+  const GlobalIndexType* out_dim = gROIFullOutput ? gFullDim : gDim;
+  sprintf(descriptor,"3 %d %d %d",out_dim[0],out_dim[1],out_dim[2]);
   seg_handle.domainDescription(std::string(descriptor));
   seg_handle.encoding(false);
 
   std::vector<std::vector<GlobalIndexType> > segmentation(tree.size());
 
+  // The metrics may have moved the vertices into the feature index
+  tree.clearFeatureIndex();
   for (LocalIndexType i=0;i<tree.size();i++) {
     segmentation[i] = std::move(tree.arc(i).mVertices);
     //segmentation[i] = tree.arc(i).mVertices;
   }
 
+  // Convert the indices of the region into indices of the full volume. The
+  // OpenMP workers do not see the thread local gDim so all extents are copied
+  if (gROIFullOutput) {
+    const GlobalIndexType dim[3] = {gDim[0],gDim[1],gDim[2]};
+    const GlobalIndexType full[3] = {gFullDim[0],gFullDim[1],gFullDim[2]};
+    const GlobalIndexType offset[3] = {gROILow[0],gROILow[1],gROILow[2]};
+
+#pragma omp parallel for schedule(dynamic,64)
+    for (int64_t i=0;i<(int64_t)segmentation.size();i++) {
+      for (GlobalIndexType& v : segmentation[i]) {
+        GlobalIndexType x = v % dim[0] + offset[0];
+        GlobalIndexType y = (v / dim[0]) % dim[1] + offset[1];
+        GlobalIndexType z = v / (dim[0]*dim[1]) + offset[2];
+
+        v = (z*full[1] + y)*full[0] + x;
+      }
+    }
+  }
+
   seg_handle.setSegmentation(&segmentation);
 
   seg_family.add(seg_handle);
@@ -586,9 +913,9 @@ int main(int argc, const char** argv)
 
 
 
-  delete[] gData;
-  delete[] labels;
-  delete metric;
+  delete[] label_buffer;
+  for (uint32_t m=0;m<metrics.size();m++)
+    delete metrics[m];
 
   return 0;
 }
@@ -0,0 +1,194 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "FullNeighborhood.h"
+#include "MTAlgorithm.h"
+
+// The data and its dimensions are thread local as in the tools
+thread_local const FunctionType* gData = NULL;
+
+thread_local GlobalIndexType gDim[3] = {48,48,48};
+
+//! Fill the volume with a few Gaussian blobs on a slowly varying background
+void make_volume(std::vector<FunctionType>& data)
+{
+  data.resize(gDim[0]*gDim[1]*gDim[2]);
+
+  for (GlobalIndexType z=0;z<gDim[2];z++) {
+    for (GlobalIndexType y=0;y<gDim[1];y++) {
+      for (GlobalIndexType x=0;x<gDim[0];x++) {
+        float f = 0.001f*(x + 2*y + 3*z);
+        for (int b=0;b<3;b++) {
+          float cx = 10 + 12*b;
+          float cy = 14 + 9*b;
+          float cz = 24 - 5*b;
+          float d = (x-cx)*(x-cx) + (y-cy)*(y-cy) + (z-cz)*(z-cz);
+          f += (1 + 0.2f*b)*exp(-d / 8);
+        }
+        data[(z*gDim[1] + y)*gDim[0] + x] = f;
+      }
+    }
+  }
+}
+
+//! Compare the trees, labels and orders of two sweeps
+int same_sweep(const MergeTree& a, const MergeTree& b, const std::vector<LocalIndexType>& la,
+               const std::vector<LocalIndexType>& lb, const std::vector<GlobalIndexType>& oa,
+               const std::vector<GlobalIndexType>& ob)
+{
+  if ((a.size() != b.size()) || (la != lb) || (oa != ob)
+      || (a.minimum() != b.minimum()) || (a.maximum() != b.maximum()))
+    return 0;
+
+  for (LocalIndexType i=0;i<a.size();i++) {
+    if ((a.node(i).index() != b.node(i).index()) || (a.node(i).down() != b.node(i).down())
+        || (a.node(i).rep() != b.node(i).rep()))
+      return 0;
+  }
+
+  return 1;
+}
+
+//! Replace the box around the given vertex by the given value, update the sweep and
+//! compare it to a new one
+int check_update(const Comparison& comp, FunctionType threshold, GlobalIndexType center,
+                 FunctionType value, const char* name)
+{
+  GlobalIndexType count = gDim[0]*gDim[1]*gDim[2];
+  std::vector<FunctionType> data,previous;
+  std::vector<GlobalIndexType> order,reference_order;
+  std::vector<LocalIndexType> labels(count),reference(count);
+  MergeTree tree,full;
+  FullNeighborhood neighborhood(gDim);
+  SweepOptions options;
+  GlobalIndexType low[3],high[3];
+  GlobalIndexType c[3] = {center % gDim[0],(center / gDim[0]) % gDim[1],center / (gDim[0]*gDim[1])};
+  Comparison& greater = (Comparison&)comp;
+
+  make_volume(data);
+
+  gData = &data[0];
+  options.mOrder = &order;
+  merge_tree_sorted_sweep(greater,neighborhood,threshold,tree,false,&labels[0],options);
+
+  for (int k=0;k<3;k++) {
+    low[k] = (c[k] > 3) ? c[k] - 3 : 0;
+    high[k] = std::min(c[k] + 4,gDim[k]);
+  }
+
+  for (GlobalIndexType z=low[2];z<high[2];z++) {
+    for (GlobalIndexType y=low[1];y<high[1];y++) {
+      for (GlobalIndexType x=low[0];x<high[0];x++) {
+        previous.push_back(data[(z*gDim[1] + y)*gDim[0] + x]);
+        data[(z*gDim[1] + y)*gDim[0] + x] = value;
+      }
+    }
+  }
+
+  merge_tree_update(greater,neighborhood,threshold,low,high,&previous[0],tree,false,&labels[0],order);
+
+  options.mOrder = &reference_order;
+  merge_tree_sorted_sweep(greater,neighborhood,threshold,full,false,&reference[0],options);
+
+  if (same_sweep(tree,full,labels,reference,order,reference_order) == 0) {
+    fprintf(stderr,"Error, the update %s differs from a new sweep\n",name);
+    return 0;
+  }
+
+  fprintf(stderr,"Update %s: %u nodes, minimum %f\n",name,tree.size(),tree.minimum());
+
+  return 1;
+}
+
+int main()
+{
+  MergeTreeComp merge_comp;
+  SplitTreeComp split_comp;
+
+#ifdef _OPENMP
+  // The minimum is rescanned in parallel which must not depend on the
+  // thread local data
+  omp_set_num_threads(4);
+#endif
+
+  // The lowest vertex of the merge tree lies at the origin and the
+  // highest one of the split tree at the peak of the third blob
+  if ((check_update(merge_comp,0.2,0,0.5,"raising the minimum of the merge tree") == 0)
+      || (check_update(merge_comp,0.2,(24*gDim[1] + 14)*gDim[0] + 10,0.1,"lowering a peak") == 0)
+      || (check_update(split_comp,0.5,(14*gDim[1] + 32)*gDim[0] + 34,0.3,
+                       "lowering the minimum of the split tree") == 0))
+    return 1;
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+/*******************************************************************************
+* Copyright (c) 2015, Lawrence Livermore National Security, LLC
+* Produced at the Lawrence Livermore National Laboratory
+* Written by Peer-Timo Bremer bremer5@llnl.gov
+* LLNL-CODE-665196
+* All rights reserved.
+* 
+* This file is part of ADAPT. For details, see
+* https://github.com/scalability-llnl/ADAPT. Please also read the
+* additional BSD notice below. Redistribution and use in source and
+* binary forms, with or without modification, are permitted provided
+* that the following conditions are met:
+* 
+* - Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the disclaimer below.
+* 
+* - Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the disclaimer (as noted below) in
+*    the documentation and/or other materials provided with the
+*    distribution.
+* 
+* - Neither the name of the LLNS/LLNL nor the names of its contributors
+*    may be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING ￼ IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Additional BSD Notice 
+* 
+* 1. This notice is required to be provided under our contract with the
+* U.S. Department of Energy (DOE). This work was produced at Lawrence
+* Livermore National Laboratory under Contract No. DE-AC52-07NA27344
+* with the DOE. 
+* 
+* 2. Neither the United States Government nor Lawrence Livermore
+* National Security, LLC nor any of their employees, makes any warranty,
+* express or implied, or assumes any liability or responsibility for the
+* accuracy, completeness, or usefulness of any information, apparatus,
+* product, or process disclosed, or represents that its use would not
+* infringe privately-owned rights. 
+* 
+* 3. Also, reference herein to any specific commercial products,
+* process, or services by trade name, trademark, manufacturer or
+* otherwise does not necessarily constitute or imply its endorsement,
+* recommendation, or favoring by the United States Government or
+* Lawrence Livermore National Security, LLC. The views and opinions of
+* authors expressed herein do not necessarily state or reflect those of
+* the United States Government or Lawrence Livermore National Security,
+* LLC, and shall not be used for advertising or product endorsement
+* purposes.
+********************************************************************************/
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include "Definitions.h"
+#include "Comparisons.h"
+#include "FullNeighborhood.h"
+#include "MTAlgorithm.h"
+
+// The data and its dimensions are thread local as in the tools
+thread_local const FunctionType* gData = NULL;
+
+thread_local GlobalIndexType gDim[3] = {48,48,48};
+
+//! Fill the volume with a few Gaussian blobs whose peaks move with t
+void make_volume(std::vector<FunctionType>& data, float t)
+{
+  data.resize(gDim[0]*gDim[1]*gDim[2]);
+
+  for (GlobalIndexType z=0;z<gDim[2];z++) {
+    for (GlobalIndexType y=0;y<gDim[1];y++) {
+      for (GlobalIndexType x=0;x<gDim[0];x++) {
+        float f = 0;
+        for (int b=0;b<3;b++) {
+          float cx = 10 + 12*b + t;
+          float cy = 14 + 9*b;
+          float cz = 24 - 5*b + t;
+          float d = (x-cx)*(x-cx) + (y-cy)*(y-cy) + (z-cz)*(z-cz);
+          f += (1 + 0.2f*b)*exp(-d / 8);
+        }
+        data[(z*gDim[1] + y)*gDim[0] + x] = f;
+      }
+    }
+  }
+}
+
+//! Compare the trees and labels of two sweeps
+int same_sweep(const MergeTree& a, const MergeTree& b, const std::vector<LocalIndexType>& la,
+               const std::vector<LocalIndexType>& lb)
+{
+  if ((a.size() != b.size()) || (la != lb))
+    return 0;
+
+  for (LocalIndexType i=0;i<a.size();i++) {
+    if ((a.node(i).index() != b.node(i).index()) || (a.node(i).down() != b.node(i).down())
+        || (a.node(i).rep() != b.node(i).rep()))
+      return 0;
+  }
+
+  return 1;
+}
+
+//! Sweep at the given threshold with and without the order of the first volume as hint
+int check_threshold(FunctionType threshold)
+{
+  GlobalIndexType count = gDim[0]*gDim[1]*gDim[2];
+  std::vector<FunctionType> first,second;
+  std::vector<GlobalIndexType> hint,order;
+  std::vector<LocalIndexType> labels(count),reference(count);
+  MergeTree tree,full;
+  MergeTreeComp greater;
+  FullNeighborhood neighborhood(gDim);
+  SweepOptions options;
+
+  make_volume(first,0);
+  make_volume(second,0.5);
+
+  gData = &first[0];
+  options.mOrder = &hint;
+  merge_tree_sorted_sweep(greater,neighborhood,threshold,tree,false,&labels[0],options);
+
+  gData = &second[0];
+  tree.clear();
+  options.mOrder = &order;
+  options.mHint = &hint;
+  merge_tree_sorted_sweep(greater,neighborhood,threshold,tree,false,&labels[0],options);
+
+  merge_tree_sorted_sweep(greater,neighborhood,threshold,full,false,&reference[0]);
+
+  if (same_sweep(tree,full,labels,reference) == 0) {
+    fprintf(stderr,"Error, the warm started sweep at threshold %f differs from a full sweep\n",threshold);
+    return 0;
+  }
+
+  fprintf(stderr,"Threshold %f: %zu vertices, %u nodes\n",threshold,hint.size(),tree.size());
+
+  return 1;
+}
+
+int main()
+{
+  // Many vertices use the warm start while fewer than one bucket of the
+  // hint above a high threshold falls back to the generic sort
+  if ((check_threshold(0.2) == 0) || (check_threshold(1.1) == 0))
+    return 1;
+
+  return 0;
+}